@@ -0,0 +1,237 @@
+// ReSharper disable CppLocalVariableMayBeConst
+#include "aabb.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "game.h"
+#include "simd.h"
+
+#ifdef SIMD_X86
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// Below this many rects a plain hasIntersection loop beats every kernel, see the aabb bench
+constexpr size_t minBatchRects = 64;
+
+// The query's edges, right and bottom summed the way hasIntersection sums them
+struct Bounds {
+    float left;
+    float right;
+    float top;
+    float bottom;
+};
+
+float heightAt(const RectSpan& rects, size_t i) {
+    return rects.h ? rects.h[i] : rects.height;
+}
+
+SDL_FRect rectAt(const RectSpan& rects, size_t i) {
+    return { rects.x[i], rects.y[i], rects.w[i], heightAt(rects, i) };
+}
+
+bool missesScalar(const Bounds& q, const RectSpan& rects, size_t i) {
+    return q.right <= rects.x[i] || rects.x[i] + rects.w[i] <= q.left || q.bottom <= rects.y[i] || rects.y[i] + heightAt(rects, i) <= q.top;
+}
+
+// The vector kernels cover whole blocks of 4 or 8 rects and return where they stopped, the
+// scalar ones finish the rest
+
+size_t firstScalar(const Bounds& q, const RectSpan& rects, size_t begin) {
+    for (size_t i = begin; i < rects.count; ++i) {
+        if (!missesScalar(q, rects, i)) {
+            return i;
+        }
+    }
+    return noIntersection;
+}
+
+size_t maskScalar(const Bounds& q, const RectSpan& rects, size_t begin, uint64_t* hits) {
+    size_t count = 0;
+    for (size_t i = begin; i < rects.count; ++i) {
+        if (!missesScalar(q, rects, i)) {
+            hits[i / 64] |= uint64_t{ 1 } << (i % 64);
+            ++count;
+        }
+    }
+    return count;
+}
+
+#ifdef SIMD_X86
+// A bit per lane of the 4 rects at i that q intersects
+__attribute__((target("sse2")))
+inline int hitsSse2(const Bounds& q, const RectSpan& rects, size_t i) {
+    __m128 x = _mm_loadu_ps(rects.x + i);
+    __m128 y = _mm_loadu_ps(rects.y + i);
+    __m128 h = rects.h ? _mm_loadu_ps(rects.h + i) : _mm_set1_ps(rects.height);
+    __m128 miss = _mm_or_ps(_mm_or_ps(_mm_cmple_ps(_mm_set1_ps(q.right), x), _mm_cmple_ps(_mm_add_ps(x, _mm_loadu_ps(rects.w + i)), _mm_set1_ps(q.left))),
+                            _mm_or_ps(_mm_cmple_ps(_mm_set1_ps(q.bottom), y), _mm_cmple_ps(_mm_add_ps(y, h), _mm_set1_ps(q.top))));
+    return ~_mm_movemask_ps(miss) & 0xF;
+}
+
+__attribute__((target("sse2")))
+size_t firstSse2(const Bounds& q, const RectSpan& rects, size_t& i) {
+    for (; i + 4 <= rects.count; i += 4) {
+        if (int hits = hitsSse2(q, rects, i)) {
+            return i + __builtin_ctz(hits);
+        }
+    }
+    return noIntersection;
+}
+
+// The mask kernels gather each word of hits in a register and store it once
+
+__attribute__((target("sse2")))
+size_t maskSse2(const Bounds& q, const RectSpan& rects, size_t& i, uint64_t* hits) {
+    size_t count = 0;
+    while (i + 4 <= rects.count) {
+        size_t wordStart = i;
+        size_t wordEnd = std::min(wordStart + 64, rects.count);
+        uint64_t word = 0;
+        for (; i + 4 <= wordEnd; i += 4) {
+            word |= static_cast<uint64_t>(hitsSse2(q, rects, i)) << (i - wordStart);
+        }
+        hits[wordStart / 64] = word;
+        count += __builtin_popcountll(word);
+    }
+    return count;
+}
+
+__attribute__((target("avx2")))
+inline int hitsAvx2(const Bounds& q, const RectSpan& rects, size_t i) {
+    __m256 x = _mm256_loadu_ps(rects.x + i);
+    __m256 y = _mm256_loadu_ps(rects.y + i);
+    __m256 h = rects.h ? _mm256_loadu_ps(rects.h + i) : _mm256_set1_ps(rects.height);
+    __m256 miss = _mm256_or_ps(
+        _mm256_or_ps(_mm256_cmp_ps(_mm256_set1_ps(q.right), x, _CMP_LE_OQ), _mm256_cmp_ps(_mm256_add_ps(x, _mm256_loadu_ps(rects.w + i)), _mm256_set1_ps(q.left), _CMP_LE_OQ)),
+        _mm256_or_ps(_mm256_cmp_ps(_mm256_set1_ps(q.bottom), y, _CMP_LE_OQ), _mm256_cmp_ps(_mm256_add_ps(y, h), _mm256_set1_ps(q.top), _CMP_LE_OQ)));
+    return ~_mm256_movemask_ps(miss) & 0xFF;
+}
+
+__attribute__((target("avx2")))
+size_t firstAvx2(const Bounds& q, const RectSpan& rects, size_t& i) {
+    for (; i + 8 <= rects.count; i += 8) {
+        if (int hits = hitsAvx2(q, rects, i)) {
+            return i + __builtin_ctz(hits);
+        }
+    }
+    return noIntersection;
+}
+
+__attribute__((target("avx2")))
+size_t maskAvx2(const Bounds& q, const RectSpan& rects, size_t& i, uint64_t* hits) {
+    size_t count = 0;
+    while (i + 8 <= rects.count) {
+        size_t wordStart = i;
+        size_t wordEnd = std::min(wordStart + 64, rects.count);
+        uint64_t word = 0;
+        for (; i + 8 <= wordEnd; i += 8) {
+            word |= static_cast<uint64_t>(hitsAvx2(q, rects, i)) << (i - wordStart);
+        }
+        hits[wordStart / 64] = word;
+        count += __builtin_popcountll(word);
+    }
+    return count;
+}
+#endif
+
+Bounds boundsOf(const SDL_FRect& rect) {
+    return { rect.x, rect.x + rect.w, rect.y, rect.y + rect.h };
+}
+
+} // namespace
+
+size_t firstIntersection(const SDL_FRect& query, const RectSpan& rects) {
+    if (rects.count < minBatchRects) {
+        for (size_t i = 0; i < rects.count; ++i) {
+            if (hasIntersection(query, rectAt(rects, i))) {
+                return i;
+            }
+        }
+        return noIntersection;
+    }
+    Bounds q = boundsOf(query);
+    size_t i = 0;
+    size_t first = noIntersection;
+    switch (simdLevel()) {
+#ifdef SIMD_X86
+    case SIMD_AVX2:
+        first = firstAvx2(q, rects, i);
+        break;
+    case SIMD_SSE2:
+        first = firstSse2(q, rects, i);
+        break;
+#endif
+    default:
+        break;
+    }
+    return first != noIntersection ? first : firstScalar(q, rects, i);
+}
+
+size_t intersectionMask(const SDL_FRect& query, const RectSpan& rects, uint64_t* hits) {
+    if (rects.count < minBatchRects) {
+        uint64_t word = 0;
+        for (size_t i = 0; i < rects.count; ++i) {
+            word |= static_cast<uint64_t>(hasIntersection(query, rectAt(rects, i))) << i;
+        }
+        if (rects.count > 0) {
+            hits[0] = word;
+        }
+        return static_cast<size_t>(__builtin_popcountll(word));
+    }
+    memset(hits, 0, (rects.count + 63) / 64 * sizeof(uint64_t));
+    Bounds q = boundsOf(query);
+    size_t i = 0;
+    size_t count = 0;
+    switch (simdLevel()) {
+#ifdef SIMD_X86
+    case SIMD_AVX2:
+        count = maskAvx2(q, rects, i, hits);
+        break;
+    case SIMD_SSE2:
+        count = maskSse2(q, rects, i, hits);
+        break;
+#endif
+    default:
+        break;
+    }
+    return count + maskScalar(q, rects, i, hits);
+}
+
+SweepHit sweep(const SDL_FRect& rect, float dx, float dy, const SDL_FRect& obstacle) {
+    // The times along the delta at which the rect starts and stops overlapping the obstacle on each
+    // axis. An axis it does not move on overlaps always or never.
+    auto axis = [](float start, float size, float delta, float obstacleStart, float obstacleSize, float& entry, float& exit) {
+        if (delta == 0) {
+            bool overlaps = start < obstacleStart + obstacleSize && obstacleStart < start + size;
+            entry = overlaps ? -INFINITY : INFINITY;
+            exit = INFINITY;
+        } else if (delta > 0) {
+            entry = (obstacleStart - (start + size)) / delta;
+            exit = (obstacleStart + obstacleSize - start) / delta;
+        } else {
+            entry = (obstacleStart + obstacleSize - start) / delta;
+            exit = (obstacleStart - (start + size)) / delta;
+        }
+    };
+    float entryX, exitX, entryY, exitY;
+    axis(rect.x, rect.w, dx, obstacle.x, obstacle.w, entryX, exitX);
+    axis(rect.y, rect.h, dy, obstacle.y, obstacle.h, entryY, exitY);
+
+    float entry = std::max(entryX, entryY);
+    SweepHit hit;
+    if (entry < 0 || entry >= 1 || entry >= std::min(exitX, exitY)) {
+        return hit;
+    }
+    hit.time = entry;
+    // On an exact corner the vertical face wins, so a fall onto a ledge lands rather than stops
+    if (entryX > entryY) {
+        hit.normalX = dx > 0 ? -1 : 1;
+        hit.edge = dx > 0 ? obstacle.x - rect.w : obstacle.x + obstacle.w;
+    } else {
+        hit.normalY = dy > 0 ? -1 : 1;
+        hit.edge = dy > 0 ? obstacle.y - rect.h : obstacle.y + obstacle.h;
+    }
+    return hit;
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include <SDL2/SDL.h>
+#include <cstddef>
+#include <cstdint>
+
+// count rects stored as four parallel arrays, the layout the batch tests read. With h null every
+// rect is height tall.
+struct RectSpan {
+    const float* x;
+    const float* y;
+    const float* w;
+    const float* h;
+    size_t count;
+    float height = 0;
+
+    [[nodiscard]] RectSpan subspan(size_t begin, size_t end) const {
+        return { x + begin, y + begin, w + begin, h ? h + begin : nullptr, end - begin, height };
+    }
+};
+
+constexpr size_t noIntersection = SIZE_MAX;
+
+// hasIntersection(query, rect) for every rect in one vectorized pass, with the same result bit for
+// bit. Short spans skip the vector kernels, they only pay off from a few dozen rects on. The first
+// index it holds for, noIntersection when there is none.
+size_t firstIntersection(const SDL_FRect& query, const RectSpan& rects);
+// Sets bit i % 64 of hits[i / 64] when it holds for rect i and clears it otherwise. hits needs
+// (rects.count + 63) / 64 words. Returns how many rects query intersects.
+size_t intersectionMask(const SDL_FRect& query, const RectSpan& rects, uint64_t* hits);
+
+// Where a rect moving by a delta first touches an obstacle. time is the fraction of the delta
+// covered before the touch, 1 when nothing is in the way, and normal points out of the surface
+// touched, 0 0 with no touch.
+struct SweepHit {
+    float time = 1;
+    float normalX = 0;
+    float normalY = 0;
+    float edge = 0; // the rect's x (normalX) or y (normalY) at the touch, exact rather than interpolated
+};
+
+// Sweeps rect by (dx, dy) against obstacle. Touching edges do not count as overlap, the same as
+// hasIntersection, so a rect can slide along a surface it rests on. An obstacle the rect already
+// overlaps is ignored, so the rect can always move out of it.
+SweepHit sweep(const SDL_FRect& rect, float dx, float dy, const SDL_FRect& obstacle);
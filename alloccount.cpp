@@ -0,0 +1,83 @@
+// ReSharper disable CppLocalVariableMayBeConst
+#include "alloccount.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+using namespace std;
+
+namespace {
+
+thread_local uint64_t threadCount = 0;
+atomic<uint64_t> totalCount = 0;
+
+} // namespace
+
+uint64_t threadAllocations() {
+    return threadCount;
+}
+
+uint64_t totalAllocations() {
+    return totalCount.load(memory_order_relaxed);
+}
+
+#ifdef MARIO_COUNT_ALLOCATIONS
+
+namespace {
+
+void* countedAlloc(size_t size) noexcept {
+    ++threadCount;
+    totalCount.fetch_add(1, memory_order_relaxed);
+    return malloc(size ? size : 1);
+}
+
+void* countedAllocOrThrow(size_t size) {
+    if (void* p = countedAlloc(size)) {
+        return p;
+    }
+    throw bad_alloc();
+}
+
+} // namespace
+
+void* operator new(size_t size) {
+    return countedAllocOrThrow(size);
+}
+
+void* operator new[](size_t size) {
+    return countedAllocOrThrow(size);
+}
+
+void* operator new(size_t size, const nothrow_t&) noexcept {
+    return countedAlloc(size);
+}
+
+void* operator new[](size_t size, const nothrow_t&) noexcept {
+    return countedAlloc(size);
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, const nothrow_t&) noexcept {
+    free(p);
+}
+
+void operator delete[](void* p, const nothrow_t&) noexcept {
+    free(p);
+}
+
+#endif
@@ -0,0 +1,17 @@
+#pragma once
+#include <cstdint>
+
+// Counts operator new calls, to check that a steady-state frame allocates nothing. alloccount.cpp
+// replaces the global operator new with a counting one only when it is compiled with
+// MARIO_COUNT_ALLOCATIONS, which CMake does for Debug builds and the benchmarks. Otherwise the
+// counts stay 0. Over-aligned allocations are never counted.
+#ifdef MARIO_COUNT_ALLOCATIONS
+constexpr bool countingAllocations = true;
+#else
+constexpr bool countingAllocations = false;
+#endif
+
+// Allocations made by the calling thread so far
+uint64_t threadAllocations();
+// Allocations made by every thread so far
+uint64_t totalAllocations();
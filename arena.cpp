@@ -0,0 +1,80 @@
+// ReSharper disable CppLocalVariableMayBeConst
+#include "arena.h"
+#include <algorithm>
+
+using namespace std;
+
+namespace {
+
+constexpr size_t minBlockBytes = 4096;
+
+size_t paddingFor(const std::byte* p, size_t alignment) {
+    auto address = reinterpret_cast<uintptr_t>(p);
+    return (alignment - address % alignment) % alignment;
+}
+
+} // namespace
+
+Arena::~Arena() {
+    releaseBlocks();
+    ::operator delete(block_);
+}
+
+void Arena::reserve(size_t bytes) {
+    if (stats_.bytes != 0 || overflow_ || bytes <= capacity_) {
+        return;
+    }
+    ::operator delete(block_);
+    block_ = static_cast<std::byte*>(::operator new(bytes));
+    capacity_ = bytes;
+    cursor_ = block_;
+    end_ = block_ + capacity_;
+    ++stats_.heapBlocks;
+}
+
+void* Arena::allocate(size_t bytes, size_t alignment) {
+    size_t padding = paddingFor(cursor_, alignment);
+    if (!cursor_ || padding + bytes > static_cast<size_t>(end_ - cursor_)) {
+        grow(bytes + alignment);
+        padding = paddingFor(cursor_, alignment);
+    }
+    std::byte* p = cursor_ + padding;
+    cursor_ = p + bytes;
+    ++stats_.allocations;
+    stats_.bytes += padding + bytes;
+    return p;
+}
+
+void Arena::grow(size_t bytes) {
+    if (!block_) {
+        reserve(max(bytes, minBlockBytes));
+        return;
+    }
+    // Carry on in a new block at least as big as everything so far, the rest of the current one
+    // stays unused until the reset
+    size_t size = max({ bytes, capacity_, stats_.bytes }) + sizeof(Overflow);
+    auto* block = static_cast<Overflow*>(::operator new(size));
+    block->next = overflow_;
+    overflow_ = block;
+    cursor_ = reinterpret_cast<std::byte*>(block + 1);
+    end_ = reinterpret_cast<std::byte*>(block) + size;
+    ++stats_.heapBlocks;
+}
+
+void Arena::releaseBlocks() {
+    while (overflow_) {
+        Overflow* next = overflow_->next;
+        ::operator delete(overflow_);
+        overflow_ = next;
+    }
+}
+
+void Arena::reset() {
+    // After spilling, the next round gets one main block with room for everything this one used
+    size_t needed = overflow_ ? stats_.bytes + stats_.bytes / 8 : 0;
+    releaseBlocks();
+    stats_ = {};
+    cursor_ = block_;
+    end_ = block_ + capacity_;
+    reserve(needed);
+}
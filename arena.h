@@ -0,0 +1,98 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+// Monotonic allocator: allocations are carved off the end of one block and never freed one by
+// one, reset() releases all of them at once. Allocations that do not fit spill into extra blocks,
+// and the next reset() replaces everything with a single block as big as they all were, so an
+// arena that is reused for the same work settles into one block and constant-time resets.
+class Arena {
+public:
+    struct Stats {
+        size_t allocations = 0; // since the last reset
+        size_t bytes = 0; // handed out since the last reset, padding included. Never goes down before a reset, so it is also the peak.
+        size_t heapBlocks = 0; // blocks taken from the heap since the last reset
+    };
+
+    Arena() = default;
+    ~Arena();
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    // Makes sure the next `bytes` of allocations fit in one block. Only does anything while the
+    // arena is empty, right after construction or a reset.
+    void reserve(size_t bytes);
+    [[nodiscard]] void* allocate(size_t bytes, size_t alignment);
+    // Room for count Ts, left uninitialized. Nothing in an arena is ever destroyed.
+    template<typename T>
+    [[nodiscard]] T* allocateArray(size_t count) {
+        static_assert(std::is_trivially_destructible_v<T>);
+        return static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+    }
+    // Frees every allocation. Whatever lives in the arena has to be gone, or never be touched again, first.
+    void reset();
+
+    [[nodiscard]] const Stats& stats() const { return stats_; }
+    [[nodiscard]] size_t capacity() const { return capacity_; }
+
+private:
+    struct Overflow {
+        Overflow* next;
+    };
+
+    void grow(size_t bytes);
+    void releaseBlocks();
+
+    std::byte* block_ = nullptr; // the main block
+    size_t capacity_ = 0;
+    std::byte* cursor_ = nullptr; // next free byte of the block being carved, main or overflow
+    std::byte* end_ = nullptr;
+    Overflow* overflow_ = nullptr; // extra blocks since the last reset, newest first
+    Stats stats_;
+};
+
+// Lets standard containers allocate from an arena. Deallocation does nothing, the memory comes
+// back with the arena's reset. Without an arena it is the plain heap allocator. The allocator
+// moves and swaps along with the memory, so a container's arena has to stay where it is while
+// the container lives.
+template<typename T>
+class ArenaAllocator {
+public:
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    ArenaAllocator() = default;
+    explicit ArenaAllocator(Arena* arena) : arena_(arena) {}
+    template<typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) : arena_(other.arena()) {} // NOLINT(*-explicit-constructor)
+
+    T* allocate(size_t count) {
+        if (arena_) {
+            return static_cast<T*>(arena_->allocate(count * sizeof(T), alignof(T)));
+        }
+        return static_cast<T*>(::operator new(count * sizeof(T)));
+    }
+
+    void deallocate(T* p, size_t) {
+        if (!arena_) {
+            ::operator delete(p);
+        }
+    }
+
+    [[nodiscard]] Arena* arena() const { return arena_; }
+
+    template<typename U>
+    bool operator==(const ArenaAllocator<U>& other) const { return arena_ == other.arena(); }
+
+private:
+    Arena* arena_ = nullptr;
+};
+
+template<typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
@@ -0,0 +1,126 @@
+// ReSharper disable CppLocalVariableMayBeConst
+#include "assetcache.h"
+#include <SDL2/SDL_image.h>
+
+using namespace std;
+
+DecodedImage decodeImage(const string& path) {
+    SDL_Surface* loaded = IMG_Load(path.c_str());
+    if (!loaded) {
+        return { nullptr, SDL_GetError() };
+    }
+    SDL_Surface* pixels = SDL_ConvertSurfaceFormat(loaded, assetPixelFormat, 0);
+    SDL_FreeSurface(loaded);
+    if (!pixels) {
+        return { nullptr, SDL_GetError() };
+    }
+    return { pixels, {} };
+}
+
+AssetCache::~AssetCache() {
+    for (auto& [name, decoded] : pending_) {
+        SDL_FreeSurface(decoded.get().pixels);
+    }
+}
+
+const AssetPackEntry* AssetCache::packedImage(const string& name) const {
+    const AssetPackEntry* entry = pack_ ? pack_->find(name) : nullptr;
+    return entry && entry->kind == ASSET_IMAGE ? entry : nullptr;
+}
+
+void AssetCache::prefetch(const vector<string>& names, ThreadPool& pool) {
+    for (const string& name : names) {
+        auto it = entries_.find(name);
+        if (packedImage(name) || pending_.contains(name) || (it != entries_.end() && it->second.loaded())) {
+            continue;
+        }
+        pending_.emplace(name, pool.submit([path = looseRoot_ + name] { return decodeImage(path); }));
+    }
+}
+
+TextureHandle AssetCache::texture(const string& name) {
+    if (auto it = entries_.find(name); it != entries_.end()) {
+        if (TextureHandle handle = it->second.texture.lock()) {
+            ++stats_.hits;
+            return handle;
+        }
+    }
+    ++stats_.misses;
+    SDL_Surface* pixels = loadPixels(name);
+    if (!pixels) {
+        return nullptr;
+    }
+    size_t bytes = static_cast<size_t>(pixels->w) * pixels->h * 4;
+    SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer_, pixels);
+    SDL_FreeSurface(pixels);
+    if (!texture) {
+        return nullptr;
+    }
+    TextureHandle handle(texture, [this, name](SDL_Texture* t) {
+        SDL_DestroyTexture(t);
+        release(name);
+    });
+    addEntry(name, { handle, {}, bytes });
+    return handle;
+}
+
+SpriteHandle AssetCache::sprite(const string& name) {
+    if (auto it = entries_.find(name); it != entries_.end()) {
+        if (SpriteHandle handle = it->second.sprite.lock()) {
+            ++stats_.hits;
+            return handle;
+        }
+    }
+    ++stats_.misses;
+    SDL_Surface* pixels = loadPixels(name);
+    if (!pixels) {
+        return nullptr;
+    }
+    size_t bytes = static_cast<size_t>(pixels->w) * pixels->h * 4;
+    const Sprite* sprite = atlas_.add(renderer_, pixels);
+    if (!sprite) {
+        return nullptr;
+    }
+    SpriteHandle handle(sprite, [this, name](const Sprite* s) {
+        atlas_.unload(s);
+        release(name);
+    });
+    addEntry(name, { {}, handle, bytes });
+    return handle;
+}
+
+SDL_Surface* AssetCache::loadPixels(const string& name) {
+    if (const AssetPackEntry* entry = packedImage(name)) {
+        auto w = static_cast<int>(entry->width);
+        auto h = static_cast<int>(entry->height);
+        void* pixels = const_cast<uint8_t*>(pack_->data(*entry)); // SDL only reads them
+        // Only wraps the mapping, freeing the surface leaves the pixels where they are
+        return SDL_CreateRGBSurfaceWithFormatFrom(pixels, w, h, 32, w * 4, assetPixelFormat);
+    }
+    DecodedImage decoded;
+    if (auto prefetched = pending_.find(name); prefetched != pending_.end()) {
+        decoded = prefetched->second.get();
+        pending_.erase(prefetched);
+    } else {
+        decoded = decodeImage(looseRoot_ + name);
+    }
+    if (!decoded.pixels) {
+        SDL_SetError("%s", decoded.error.c_str());
+    }
+    return decoded.pixels;
+}
+
+void AssetCache::addEntry(const string& name, Entry entry) {
+    ++stats_.residentTextures;
+    stats_.residentBytes += entry.bytes;
+    entries_[name] = std::move(entry);
+}
+
+void AssetCache::release(const string& name) {
+    auto it = entries_.find(name);
+    if (it != entries_.end() && !it->second.loaded()) {
+        --stats_.residentTextures;
+        stats_.residentBytes -= it->second.bytes;
+        entries_.erase(it);
+    }
+}
@@ -0,0 +1,84 @@
+#pragma once
+#include <SDL2/SDL.h>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "assetpack.h"
+#include "spriteatlas.h"
+#include "threadpool.h"
+
+// A texture or atlas sprite shared by everyone who asked for the same file. It is unloaded with its last handle.
+using TextureHandle = std::shared_ptr<SDL_Texture>;
+using SpriteHandle = std::shared_ptr<const Sprite>;
+
+// An image file decoded into an assetPixelFormat surface, or the error why it could not be. Safe
+// to call from any thread, it never touches a renderer.
+struct DecodedImage {
+    SDL_Surface* pixels;
+    std::string error;
+};
+DecodedImage decodeImage(const std::string& path);
+
+// Every texture the game draws, keyed by name, a path relative to the source tree like
+// "resources/brick.png". Images in the asset pack are uploaded straight from its mapping, the rest
+// are decoded from looseRoot + name. Either way a name is loaded once and then handed out again for
+// as long as any handle to it is alive, so whoever wants an asset to stay loaded (both characters,
+// the backgrounds) just keeps a handle. The cache has to outlive every handle, the pack the cache.
+class AssetCache {
+public:
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0; // each one an upload, and a decode for loose files
+        size_t residentTextures = 0;
+        size_t residentBytes = 0; // of texture memory, at 4 bytes a pixel
+    };
+
+    // pack may be nullptr
+    AssetCache(SDL_Renderer* renderer, SpriteAtlas& atlas, const AssetPack* pack, std::string looseRoot)
+        : renderer_(renderer), atlas_(atlas), pack_(pack), looseRoot_(std::move(looseRoot)) {}
+    ~AssetCache();
+
+    AssetCache(const AssetCache&) = delete;
+    AssetCache& operator=(const AssetCache&) = delete;
+
+    // Starts decoding the loose files among names on pool. texture() and sprite() for one of them then
+    // only wait for its decode and upload the result, uploads have to stay on the thread that owns the renderer.
+    void prefetch(const std::vector<std::string>& names, ThreadPool& pool);
+
+    // An empty handle, with the error in SDL_GetError, when the image can't be loaded
+    TextureHandle texture(const std::string& name);
+    // Like texture, but loaded into the sprite atlas so SpriteBatch can draw it from a page.
+    // The atlas still has to be packed afterwards.
+    SpriteHandle sprite(const std::string& name);
+
+    [[nodiscard]] const Stats& stats() const { return stats_; }
+
+private:
+    struct Entry {
+        std::weak_ptr<SDL_Texture> texture; // whichever of the two name was loaded as
+        std::weak_ptr<const Sprite> sprite;
+        size_t bytes;
+
+        [[nodiscard]] bool loaded() const { return !texture.expired() || !sprite.expired(); }
+    };
+
+    // name's pixels, wrapping the pack's mapping or decoded, nullptr with the error in SDL_GetError
+    SDL_Surface* loadPixels(const std::string& name);
+    // Keeps entry as name's and counts its bytes as resident
+    void addEntry(const std::string& name, Entry entry);
+    // The pack's image called name, nullptr when it is not in the pack
+    [[nodiscard]] const AssetPackEntry* packedImage(const std::string& name) const;
+    // Drops name's entry once neither of its handles is alive
+    void release(const std::string& name);
+
+    SDL_Renderer* renderer_;
+    SpriteAtlas& atlas_;
+    const AssetPack* pack_;
+    std::string looseRoot_;
+    std::unordered_map<std::string, Entry> entries_;
+    std::unordered_map<std::string, std::future<DecodedImage>> pending_; // prefetched, not uploaded yet
+    Stats stats_;
+};
@@ -0,0 +1,76 @@
+// ReSharper disable CppLocalVariableMayBeConst
+#include "assetpack.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+using namespace std;
+
+AssetPack::AssetPack(const string& path) : file_(path) {
+    if (!file_.isOpen()) {
+        return;
+    }
+    auto invalid = [&](const string& reason) {
+        cerr << "Ignoring " << path << ": " << reason << endl;
+        file_ = MappedFile();
+    };
+    if (file_.size() < sizeof(header_)) {
+        invalid("not an asset pack");
+        return;
+    }
+    memcpy(&header_, file_.data(), sizeof(header_));
+    if (memcmp(header_.magic, assetPackMagic, sizeof(header_.magic)) != 0 || header_.version != assetPackVersion) {
+        invalid("not a version " + to_string(assetPackVersion) + " asset pack");
+        return;
+    }
+    size_t namesOffset = sizeof(header_) + static_cast<size_t>(header_.entryCount) * sizeof(AssetPackEntry);
+    if (file_.size() < namesOffset) {
+        invalid("file is truncated");
+        return;
+    }
+    // The mapping is page aligned and the header a multiple of 8 bytes, so the entries can be used in place
+    entries_ = reinterpret_cast<const AssetPackEntry*>(file_.data() + sizeof(header_));
+    names_ = reinterpret_cast<const char*>(file_.data() + namesOffset);
+    for (uint32_t i = 0; i < header_.entryCount; ++i) {
+        const AssetPackEntry& entry = entries_[i];
+        if (namesOffset + entry.nameOffset + entry.nameLength > file_.size() || entry.offset > file_.size() || entry.size > file_.size() - entry.offset) {
+            invalid("file is truncated");
+            return;
+        }
+    }
+}
+
+string_view AssetPack::name(const AssetPackEntry& entry) const {
+    return { names_ + entry.nameOffset, entry.nameLength };
+}
+
+const AssetPackEntry* AssetPack::find(string_view name) const {
+    if (!isOpen()) {
+        return nullptr;
+    }
+    const AssetPackEntry* end = entries_ + header_.entryCount;
+    const AssetPackEntry* it = lower_bound(entries_, end, name, [this](const AssetPackEntry& entry, string_view key) { return this->name(entry) < key; });
+    return it != end && this->name(*it) == name ? it : nullptr;
+}
+
+vector<string> AssetPack::names(string_view prefix) const {
+    vector<string> names;
+    if (!isOpen()) {
+        return names;
+    }
+    for (uint32_t i = 0; i < header_.entryCount; ++i) {
+        string_view entryName = name(entries_[i]);
+        if (entryName.starts_with(prefix)) {
+            names.emplace_back(entryName);
+        }
+    }
+    return names;
+}
+
+bool AssetPack::matchesMixer() const {
+    int frequency = 0;
+    Uint16 format = 0;
+    int channels = 0;
+    return Mix_QuerySpec(&frequency, &format, &channels) != 0 && frequency == header_.audioFrequency && format == header_.audioFormat &&
+           channels == header_.audioChannels;
+}
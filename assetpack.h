@@ -0,0 +1,86 @@
+#pragma once
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_mixer.h>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "mappedfile.h"
+
+// Asset pack (.pak) layout, written by the assetpack tool at build time and memory-mapped by the game:
+//   AssetPackHeader
+//   AssetPackEntry entries[entryCount]     sorted by name
+//   char names[]                           the entry names, not terminated
+//   entry data                             each entry at a 16-byte boundary
+// Names are paths relative to the source tree, "resources/brick.png" or "levels/level1.lvl".
+// Like the compiled levels, everything is in host byte order and the pack is rebuilt with the game.
+
+constexpr char assetPackMagic[4] = { 'M', 'P', 'A', 'K' };
+constexpr uint32_t assetPackVersion = 1;
+constexpr size_t assetPackAlignment = 16;
+
+// Pixels of decoded and packed images, the format SDL's renderers list first
+constexpr Uint32 assetPixelFormat = SDL_PIXELFORMAT_ARGB8888;
+// What the game opens the mixer with, and so what the packer converts sounds to
+constexpr int mixerFrequency = 44100;
+constexpr Uint16 mixerFormat = MIX_DEFAULT_FORMAT;
+constexpr int mixerChannels = 2;
+
+enum AssetKind : uint32_t {
+    ASSET_FILE, // the file's bytes as they are, like the font
+    ASSET_IMAGE, // width * height pixels in assetPixelFormat, rows without padding
+    ASSET_SOUND, // PCM in the header's audio format, ready for Mix_QuickLoad_RAW
+    ASSET_LEVEL // a compiled level, see levelformat.h
+};
+
+struct AssetPackHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t entryCount;
+    int32_t audioFrequency; // the mixer format the packer got from Mix_QuerySpec
+    uint16_t audioFormat;
+    uint16_t audioChannels;
+    uint32_t reserved;
+};
+static_assert(sizeof(AssetPackHeader) == 24);
+
+struct AssetPackEntry {
+    uint32_t kind; // AssetKind
+    uint32_t nameOffset; // into names
+    uint32_t nameLength;
+    uint32_t width; // images only
+    uint32_t height;
+    uint32_t reserved;
+    uint64_t offset; // of the data, from the start of the file
+    uint64_t size;
+};
+static_assert(sizeof(AssetPackEntry) == 40);
+
+// A memory-mapped asset pack. Everything made from its entries may point into the mapping, so the
+// pack has to outlive it.
+class AssetPack {
+public:
+    AssetPack() = default;
+    // isOpen() is false, with the reason on cerr, if the file is there but not a valid pack
+    explicit AssetPack(const std::string& path);
+
+    [[nodiscard]] bool isOpen() const { return file_.isOpen(); }
+    [[nodiscard]] const AssetPackHeader& header() const { return header_; }
+
+    // nullptr when there is no entry called name
+    [[nodiscard]] const AssetPackEntry* find(std::string_view name) const;
+    [[nodiscard]] const uint8_t* data(const AssetPackEntry& entry) const { return file_.data() + entry.offset; }
+    // The names of the entries starting with prefix, sorted
+    [[nodiscard]] std::vector<std::string> names(std::string_view prefix) const;
+
+    // Whether the sounds were converted to the format the mixer is open with now
+    [[nodiscard]] bool matchesMixer() const;
+
+private:
+    [[nodiscard]] std::string_view name(const AssetPackEntry& entry) const;
+
+    MappedFile file_;
+    AssetPackHeader header_{};
+    const AssetPackEntry* entries_ = nullptr;
+    const char* names_ = nullptr;
+};
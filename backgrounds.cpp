@@ -0,0 +1,50 @@
+// ReSharper disable CppLocalVariableMayBeConst
+#include "backgrounds.h"
+#include <algorithm>
+
+using namespace std;
+
+SDL_Texture* BackgroundCache::get(size_t index) {
+    auto it = ranges::find(lru_, index, &Resident::index);
+    if (it != lru_.end()) {
+        lru_.splice(lru_.begin(), lru_, it);
+        return lru_.front().texture.get();
+    }
+
+    TextureHandle texture = assets_.texture(files_[index]);
+    if (!texture) {
+        return nullptr;
+    }
+    int w = 0;
+    int h = 0;
+    SDL_QueryTexture(texture.get(), nullptr, nullptr, &w, &h);
+    size_t bytes = static_cast<size_t>(w) * h * 4;
+    lru_.push_front({ index, std::move(texture), bytes });
+    ++stats_.loads;
+    ++stats_.residentTextures;
+    stats_.residentBytes += bytes;
+    stats_.peakBytes = max(stats_.peakBytes, stats_.residentBytes);
+    evict();
+    return lru_.front().texture.get();
+}
+
+void BackgroundCache::prefetch(size_t index, ThreadPool& pool) {
+    if (index < files_.size() && ranges::find(lru_, index, &Resident::index) == lru_.end()) {
+        assets_.prefetch({ files_[index] }, pool);
+    }
+}
+
+void BackgroundCache::evict() {
+    while (stats_.residentBytes > budgetBytes_ && lru_.size() > 1) {
+        stats_.residentBytes -= lru_.back().bytes;
+        --stats_.residentTextures;
+        ++stats_.evictions;
+        lru_.pop_back();
+    }
+}
+
+void BackgroundCache::clear() {
+    lru_.clear();
+    stats_.residentTextures = 0;
+    stats_.residentBytes = 0;
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <SDL2/SDL.h>
+#include <cstdint>
+#include <list>
+#include <string>
+#include <vector>
+#include "assetcache.h"
+#include "threadpool.h"
+
+// The level backgrounds, each loaded the first time a level shows it rather than all at startup.
+// Loaded ones stay resident while they fit in the byte budget, the least recently used go first.
+// The one get() returned last is never evicted, even if it alone is over the budget.
+class BackgroundCache {
+public:
+    struct Stats {
+        size_t residentTextures = 0;
+        size_t residentBytes = 0;
+        size_t peakBytes = 0;
+        uint64_t loads = 0;
+        uint64_t evictions = 0;
+    };
+
+    // files are asset names, see AssetCache
+    BackgroundCache(AssetCache& assets, std::vector<std::string> files, size_t budgetBytes)
+        : assets_(assets), files_(std::move(files)), budgetBytes_(budgetBytes) {}
+
+    [[nodiscard]] size_t count() const { return files_.size(); }
+    [[nodiscard]] size_t budgetBytes() const { return budgetBytes_; }
+    [[nodiscard]] const Stats& stats() const { return stats_; }
+
+    // Background index, loaded if it isn't resident. nullptr, with the error in SDL_GetError, when it can't be.
+    SDL_Texture* get(size_t index);
+    // Starts decoding background index on pool so that a later get() only has to upload it
+    void prefetch(size_t index, ThreadPool& pool);
+    // Drops every background, before the cache they came from goes
+    void clear();
+
+private:
+    struct Resident {
+        size_t index;
+        TextureHandle texture;
+        size_t bytes;
+    };
+
+    void evict();
+
+    AssetCache& assets_;
+    std::vector<std::string> files_;
+    size_t budgetBytes_;
+    std::list<Resident> lru_; // most recently used first
+    Stats stats_;
+};
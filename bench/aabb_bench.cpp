@@ -0,0 +1,51 @@
+// hasIntersection called once per rect against the batch tests in aabb.h on every instruction
+// set, for one query rect that misses every rect, so each test has to look at all of them. Spans
+// shorter than the batch threshold take the same plain loop on every instruction set.
+#include <random>
+#include <string>
+#include <vector>
+#include "bench.h"
+#include "../aabb.h"
+#include "../game.h"
+#include "../simd.h"
+
+using namespace std;
+
+void benchAabb() {
+    mt19937 rng(5);
+    uniform_real_distribution<float> position(0, 10000);
+    const SDL_FRect query = { -100, -100, TILE_SIZE, TILE_SIZE };
+    SimdLevel best = simdLevel();
+
+    for (size_t count : { 8, 16, 32, 64, 1024, 65536 }) {
+        vector<SDL_FRect> rects(count);
+        vector<float> x(count), y(count), w(count, TILE_SIZE), h(count, TILE_SIZE);
+        for (size_t i = 0; i < count; ++i) {
+            rects[i] = { position(rng), position(rng), TILE_SIZE, TILE_SIZE };
+            x[i] = rects[i].x;
+            y[i] = rects[i].y;
+        }
+        RectSpan span = { x.data(), y.data(), w.data(), h.data(), count };
+        vector<uint64_t> hits((count + 63) / 64);
+        size_t iterations = max<size_t>(100, 100000000 / count);
+        string suffix = " (" + to_string(count) + " rects)";
+
+        report("hasIntersection loop" + suffix, timeNs(iterations, [&] {
+            size_t first = noIntersection;
+            for (size_t i = 0; i < count; ++i) {
+                if (hasIntersection(query, rects[i])) {
+                    first = i;
+                    break;
+                }
+            }
+            doNotOptimize(first);
+        }));
+        for (int level = SIMD_SCALAR; level <= best; ++level) {
+            setSimdLevel(static_cast<SimdLevel>(level));
+            string name = simdLevelName(static_cast<SimdLevel>(level));
+            report("firstIntersection " + name + suffix, timeNs(iterations, [&] { doNotOptimize(firstIntersection(query, span)); }));
+            report("intersectionMask " + name + suffix, timeNs(iterations, [&] { doNotOptimize(intersectionMask(query, span, hits.data())); }));
+        }
+        setSimdLevel(best);
+    }
+}
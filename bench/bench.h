@@ -0,0 +1,31 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+// Keeps the optimizer from discarding a value that is only computed for timing
+template<typename T>
+inline void doNotOptimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// Calls fn() `iterations` times and returns the mean wall time per call in nanoseconds
+template<typename Fn>
+double timeNs(size_t iterations, Fn&& fn) {
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        fn();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::nano>(elapsed).count() / static_cast<double>(iterations);
+}
+
+void report(const std::string& name, double nsPerOp);
+
+void benchTileGrid();
+void benchLevelLoad();
+void benchStartScreen();
+void benchSprites();
+void benchEnemies();
+void benchAabb();
+void benchScenarios();
@@ -0,0 +1,68 @@
+// One enemy tick (EnemySet::update and the overlap test tickPlaying runs before it) for every
+// kernel on one thread, then the best kernel on more and more threads, on up to a million enemies
+#include <algorithm>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "bench.h"
+#include "../enemies.h"
+#include "../simd.h"
+#include "../threadpool.h"
+
+using namespace std;
+
+namespace {
+
+// Patrols of up to 20 tiles scattered over a 10000 x 100 tile level, the player nowhere near any
+void generateEnemies(EnemySet& enemies, size_t count, mt19937& rng) {
+    uniform_int_distribution<int> col(0, 10000);
+    uniform_int_distribution<int> row(0, 100);
+    uniform_int_distribution<int> length(1, 20);
+    enemies.clear();
+    enemies.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        auto x = static_cast<float>(col(rng) * TILE_SIZE);
+        auto y = static_cast<float>(row(rng) * TILE_SIZE);
+        SDL_FRect rect = { x, y + TILE_SIZE * 0.25f, TILE_SIZE * 0.75f, TILE_SIZE * 0.75f };
+        SDL_FRect path = { x, y, static_cast<float>(length(rng) * TILE_SIZE), TILE_SIZE };
+        enemies.add(rect, path, ENEMY_SPEED);
+    }
+}
+
+} // namespace
+
+void benchEnemies() {
+    mt19937 rng(11);
+    const SDL_FRect player = { -1000, -1000, TILE_SIZE, TILE_SIZE };
+    SimdLevel best = simdLevel();
+    // One thread is the kernel passes above, the pools start at two
+    vector<size_t> threadCounts;
+    for (size_t threads = 2; threads < thread::hardware_concurrency(); threads *= 2) {
+        threadCounts.push_back(threads);
+    }
+    if (thread::hardware_concurrency() > 1) {
+        threadCounts.push_back(thread::hardware_concurrency());
+    }
+
+    for (size_t count : { 1000, 100000, 1000000 }) {
+        EnemySet enemies;
+        generateEnemies(enemies, count, rng);
+        size_t iterations = max<size_t>(20, 200000000 / count);
+        string suffix = " (" + to_string(count) + " enemies)";
+
+        for (int level = SIMD_SCALAR; level <= best; ++level) {
+            setSimdLevel(static_cast<SimdLevel>(level));
+            report(string("tick ") + simdLevelName(static_cast<SimdLevel>(level)) + ", 1 thread" + suffix, timeNs(iterations, [&] {
+                doNotOptimize(enemies.anyOverlapping(player, nullptr) + enemies.update(player, TICK_SECONDS, nullptr));
+            }));
+        }
+        setSimdLevel(best);
+        for (size_t threads : threadCounts) {
+            ThreadPool pool(threads);
+            report(string("tick ") + simdLevelName(best) + ", " + to_string(threads) + " threads" + suffix, timeNs(iterations, [&] {
+                doNotOptimize(enemies.anyOverlapping(player, &pool) + enemies.update(player, TICK_SECONDS, &pool));
+            }));
+        }
+    }
+}
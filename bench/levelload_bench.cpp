@@ -0,0 +1,103 @@
+// Load time of the text parser versus the memory-mapped compiled format on generated levels
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+#include "bench.h"
+#include "../level.h"
+#include "../levelformat.h"
+
+using namespace std;
+
+namespace {
+
+void writeTextLevel(const string& path, int cols, int rows, mt19937& rng) {
+    uniform_int_distribution<int> roll(0, 99);
+    ofstream out(path);
+    string line;
+    for (int row = 0; row < rows; ++row) {
+        line.assign(cols, '.');
+        for (int col = 0; col < cols; ++col) {
+            int r = roll(rng);
+            line[col] = r < 30 ? '1' : r < 40 ? '/' : r < 45 ? '+' : r < 46 ? '^' : r < 47 ? '$' : '.';
+        }
+        if (row == rows - 2) {
+            line[0] = '@';
+            line[cols - 1] = 'D';
+        }
+        out << line << '\n';
+    }
+}
+
+} // namespace
+
+void benchLevelLoad() {
+    // loadLevel only stores these pointers, it never dereferences them
+    vector<const Sprite*> sprites(8, nullptr);
+    vector<const Sprite*> playerSprites(7, nullptr);
+
+    filesystem::path dir = filesystem::temp_directory_path() / "marioSDL_bench";
+    filesystem::create_directories(dir);
+    mt19937 rng(7);
+
+    struct Size { int cols, rows; };
+    for (Size size : { Size{ 20, 15 }, Size{ 6667, 15 }, Size{ 66667, 15 }, Size{ 1000, 1000 } }) {
+        string name = to_string(size.cols) + "x" + to_string(size.rows);
+        string textPath = (dir / (name + ".lvl")).string();
+        string compiledPath = (dir / (name + ".lvlb")).string();
+        writeTextLevel(textPath, size.cols, size.rows, rng);
+        {
+            ifstream in(textPath);
+            writeCompiledLevel(parseLevelText(in), compiledPath);
+        }
+
+        size_t iterations = max<size_t>(3, 2000000 / (static_cast<size_t>(size.cols) * size.rows));
+        Level level;
+        double text = timeNs(iterations, [&] {
+            loadLevelText(textPath, level, sprites, playerSprites);
+            doNotOptimize(level.residentChunks.size());
+        });
+        double compiled = timeNs(iterations, [&] {
+            loadCompiledLevel(compiledPath, level, sprites, playerSprites);
+            doNotOptimize(level.residentChunks.size());
+        });
+        report("loadLevel text     " + name, text);
+        report("loadLevel compiled " + name, compiled);
+        printf("%-48s %14.2fx\n", ("speed-up " + name).c_str(), text / compiled);
+        // The level was loaded many times over by now, so the arena has settled on one block
+        loadLevelText(textPath, level, sprites, playerSprites);
+        printf("%-48s %14zu allocs %9.1f KiB %3zu blocks\n", ("arena text     " + name).c_str(), level.loadStats.allocations, level.loadStats.bytes / 1024.0, level.loadStats.heapBlocks);
+        loadCompiledLevel(compiledPath, level, sprites, playerSprites);
+        printf("%-48s %14zu allocs %9.1f KiB %3zu blocks\n", ("arena compiled " + name).c_str(), level.loadStats.allocations, level.loadStats.bytes / 1024.0, level.loadStats.heapBlocks);
+
+        // Pan the camera across the whole level a few pixels per frame, like a player running through it
+        float step = 8;
+        size_t frames = static_cast<size_t>((level.width() - SCREEN_WIDTH) / step) + 1;
+        size_t maxResident = 0;
+        SDL_FRect view = cameraView(level, level.player);
+        view.x = 0;
+        double pan = timeNs(frames, [&] {
+            streamChunks(level, view);
+            maxResident = max(maxResident, level.residentChunks.size());
+            view.x += step;
+        });
+        report("streamChunks per frame " + name, pan);
+        printf("%-48s %14zu chunks\n", ("max resident " + name).c_str(), maxResident);
+    }
+
+    // getLevelFiles on a folder of levels, as the level select and --headless list it
+    for (int count : { 10, 100, 1000 }) {
+        filesystem::path folder = dir / ("files" + to_string(count));
+        filesystem::create_directories(folder);
+        for (int i = 0; i < count; ++i) {
+            // Written in reverse order, the worst case for a sort that assumes the listing is sorted
+            ofstream(folder / ("level" + to_string(count - i) + ".lvl")) << "@D\n";
+        }
+        report("getLevelFiles " + to_string(count) + " files", timeNs(max(3, 20000 / count), [&] {
+            doNotOptimize(getLevelFiles(folder.string()).size());
+        }));
+    }
+
+    filesystem::remove_all(dir);
+}
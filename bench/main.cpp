@@ -0,0 +1,91 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "bench.h"
+
+using namespace std;
+
+struct Suite {
+    const char* name;
+    void (*run)();
+};
+
+const Suite suites[] = {
+    { "tilegrid", benchTileGrid },
+    { "levelload", benchLevelLoad },
+    { "startscreen", benchStartScreen },
+    { "sprites", benchSprites },
+    { "enemies", benchEnemies },
+    { "aabb", benchAabb },
+    { "scenarios", benchScenarios },
+};
+
+struct Result {
+    const char* suite;
+    string name;
+    double nsPerOp;
+};
+
+const char* currentSuite = "";
+vector<Result> results;
+
+void report(const string& name, double nsPerOp) {
+    printf("%-48s %14.1f ns/op\n", name.c_str(), nsPerOp);
+    results.push_back({ currentSuite, name, nsPerOp });
+}
+
+string jsonString(const string& text) {
+    string quoted = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            quoted += '\\';
+        }
+        quoted += c;
+    }
+    return quoted + "\"";
+}
+
+// {"results":[{"suite":..,"name":..,"ns_per_op":..},...]}, what tools/bench_compare.py reads
+bool writeJson(const string& path) {
+    ofstream out(path);
+    out << fixed;
+    out.precision(1);
+    out << "{\"results\":[\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result& result = results[i];
+        out << "  {\"suite\":" << jsonString(result.suite) << ",\"name\":" << jsonString(result.name) << ",\"ns_per_op\":" << result.nsPerOp << "}"
+            << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    out << "]}\n";
+    return static_cast<bool>(out);
+}
+
+// Usage: marioSDL_bench [--json FILE] [suite...], runs every suite when none are named
+int main(int argc, char* argv[]) {
+    string jsonPath;
+    vector<string> selected;
+    for (int i = 1; i < argc; ++i) {
+        if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+            jsonPath = argv[++i];
+        } else {
+            selected.emplace_back(argv[i]);
+        }
+    }
+
+    for (const Suite& suite : suites) {
+        if (selected.empty() || ranges::find(selected, suite.name) != selected.end()) {
+            printf("[%s]\n", suite.name);
+            currentSuite = suite.name;
+            suite.run();
+        }
+    }
+
+    if (!jsonPath.empty() && !writeJson(jsonPath)) {
+        fprintf(stderr, "Could not write %s\n", jsonPath.c_str());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,45 @@
+// Every level shipped in levels/ and every level of the generated stress corpus, played through
+// the headless session with the same scripted player as marioSDL --headless --bench, timed per
+// tick. Run from the build directory.
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include "bench.h"
+#include "../alloccount.h"
+#include "../headless.h"
+#include "../session.h"
+#include "../threadpool.h"
+
+using namespace std;
+
+namespace {
+
+void playFolder(const string& folder, uint64_t ticks, ThreadPool& workers) {
+    vector<string> levelFiles;
+    if (filesystem::is_directory(folder)) {
+        levelFiles = getLevelFiles(folder);
+    }
+    if (levelFiles.empty()) {
+        printf("skipped: no levels in %s (run from the build directory)\n", folder.c_str());
+        return;
+    }
+
+    for (int index = 0; index < static_cast<int>(levelFiles.size()); ++index) {
+        string name = filesystem::path(levelFiles[index]).filename().string();
+        GameSession session;
+        initHeadlessSession(session, levelFiles, workers);
+        report("scenario " + name + " startLevel", timeNs(ticks > TICK_RATE * 5 ? 20 : 3, [&] { session.startLevel(index); }));
+        uint64_t allocations = totalAllocations();
+        report("scenario " + name + " tick", timeNs(1, [&] { doNotOptimize(playScripted(session, index, ticks)); }) / static_cast<double>(ticks));
+        printf("%-48s %14.3f allocs/tick\n", ("scenario " + name + " heap").c_str(), static_cast<double>(totalAllocations() - allocations) / static_cast<double>(ticks));
+    }
+}
+
+} // namespace
+
+void benchScenarios() {
+    ThreadPool workers;
+    playFolder("../levels", TICK_RATE * 20, workers);
+    playFolder("stress", TICK_RATE * 5, workers); // written by levelgen --corpus, a dependency of this target
+}
@@ -0,0 +1,131 @@
+// A frame of level1's world drawn the old way, one SDL_RenderCopyF per sprite from its own texture,
+// versus through the sprite atlas and batch. Reports the draw calls and texture switches of each.
+// Runs on the software renderer; set SDL_VIDEODRIVER to use a real display instead of the dummy one.
+#include <SDL2/SDL.h>
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "bench.h"
+#include "../assetcache.h"
+#include "../level.h"
+#include "../renderstats.h"
+#include "../spriteatlas.h"
+
+using namespace std;
+
+namespace {
+
+const char* const spritePaths[] = {
+    "brick.png", "vine.png", "star-coin.png", "enemy/left.png", "enemy/right.png", "door/closed.png", "door/open.png", "life.png",
+    "player/mario/left.png", "player/mario/right.png", "player/mario/walkingleft.png", "player/mario/walkingright.png",
+    "player/mario/lost.png", "player/mario/jumpingleft.png", "player/mario/jumpingright.png",
+};
+
+// Everything renderWorld draws while playing, handed to drawSprite in the same order
+template<typename DrawFn>
+void drawWorld(const Level& level, const SDL_FRect& camera, DrawFn&& drawSprite) {
+    auto drawObject = [&](const GameObject& obj) {
+        if (hasIntersection(obj.rect, camera)) {
+            drawSprite(*obj.sprite, SDL_FRect{ obj.rect.x - camera.x, obj.rect.y - camera.y, obj.rect.w, obj.rect.h });
+        }
+    };
+    for (const Chunk* chunk : level.residentChunks) {
+        for (const GameObject& obj : chunk->gameObjects) {
+            drawObject(obj);
+        }
+    }
+    drawObject(level.door);
+    drawObject(level.player);
+    for (size_t i = 0; i < level.enemies.size(); ++i) {
+        drawObject({ level.enemies.sprite(i), level.enemies.rect(i), OBJECT_ENEMY });
+    }
+}
+
+} // namespace
+
+void benchSprites() {
+    SDL_SetHint(SDL_HINT_VIDEODRIVER, "dummy");
+    if (SDL_Init(SDL_INIT_VIDEO) != 0) {
+        printf("skipped: %s\n", SDL_GetError());
+        return;
+    }
+    SDL_Window* window = SDL_CreateWindow("bench", 0, 0, SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_HIDDEN);
+    SDL_Renderer* renderer = window ? SDL_CreateRenderer(window, -1, SDL_RENDERER_SOFTWARE) : nullptr;
+    SpriteAtlas atlas;
+    vector<const Sprite*> sprites;
+    // The baseline: every sprite uploaded alone, as before the atlas
+    unordered_map<const Sprite*, SDL_Texture*> ownTextures;
+    for (const char* path : spritePaths) {
+        DecodedImage decoded = decodeImage(string("../resources/") + path);
+        SDL_Texture* ownTexture = renderer && decoded.pixels ? SDL_CreateTextureFromSurface(renderer, decoded.pixels) : nullptr;
+        if (!ownTexture) {
+            SDL_FreeSurface(decoded.pixels);
+            break;
+        }
+        const Sprite* sprite = atlas.add(renderer, decoded.pixels);
+        if (!sprite) {
+            SDL_DestroyTexture(ownTexture);
+            break;
+        }
+        sprites.push_back(sprite);
+        ownTextures[sprite] = ownTexture;
+    }
+
+    if (sprites.size() != size(spritePaths) || !atlas.pack(renderer)) {
+        printf("skipped: no renderer or sprites (run from the build directory) %s\n", SDL_GetError());
+    } else {
+        SDL_Texture* background = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC, SCREEN_WIDTH, SCREEN_HEIGHT);
+        vector levelSprites(sprites.begin(), sprites.begin() + 8);
+        vector playerSprites(sprites.begin() + 8, sprites.end());
+        Level level;
+        loadLevelText("../levels/level1.lvl", level, levelSprites, playerSprites);
+        SDL_FRect camera = cameraView(level, level.player);
+        SpriteBatch batch;
+        constexpr size_t frames = 2000;
+
+        RenderStats perSprite;
+        RenderStats batched;
+        auto frame = [&](RenderStats& stats, auto&& drawSprites) {
+            renderStats = {};
+            SDL_RenderClear(renderer);
+            SDL_RenderCopyF(renderer, background, nullptr, nullptr);
+            renderStats.draw(background);
+            drawSprites();
+            SDL_RenderPresent(renderer);
+            stats = renderStats;
+        };
+        double copies = timeNs(frames, [&] {
+            frame(perSprite, [&] {
+                drawWorld(level, camera, [&](const Sprite& sprite, const SDL_FRect& dest) {
+                    SDL_Texture* texture = ownTextures.find(&sprite)->second;
+                    SDL_RenderCopyF(renderer, texture, nullptr, &dest);
+                    renderStats.draw(texture);
+                });
+            });
+        });
+        double atlased = timeNs(frames, [&] {
+            frame(batched, [&] {
+                drawWorld(level, camera, [&](const Sprite& sprite, const SDL_FRect& dest) { batch.draw(renderer, sprite, dest); });
+                batch.flush(renderer);
+            });
+        });
+        report("level1 frame, a copy per sprite", copies);
+        report("level1 frame, atlas and sprite batch", atlased);
+        printf("%-48s %8d calls %5d switches\n", "level1 frame, a copy per sprite", perSprite.drawCalls, perSprite.textureSwitches);
+        printf("%-48s %8d calls %5d switches\n", "level1 frame, atlas and sprite batch", batched.drawCalls, batched.textureSwitches);
+        printf("%-48s %14zu pages\n", "sprite atlas", atlas.pageCount());
+        SDL_DestroyTexture(background);
+    }
+    for (const auto& [sprite, texture] : ownTextures) {
+        SDL_DestroyTexture(texture);
+    }
+    atlas.destroy();
+    if (renderer) {
+        SDL_DestroyRenderer(renderer);
+    }
+    if (window) {
+        SDL_DestroyWindow(window);
+    }
+    SDL_Quit();
+}
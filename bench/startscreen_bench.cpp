@@ -0,0 +1,115 @@
+// Frames per second of the start screen with the old per-call text rendering (a TTF surface and
+// a texture for every string, TTF_SizeText for every button rect) versus the glyph atlas.
+// Runs on the software renderer; set SDL_VIDEODRIVER to use a real display instead of the dummy one.
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+#include <cstdio>
+#include <string>
+#include "bench.h"
+#include "../game.h"
+#include "../glyphatlas.h"
+
+using namespace std;
+
+namespace {
+
+struct Button {
+    string text;
+    float x;
+    float y;
+};
+
+constexpr int padding = 10;
+const SDL_Color white = { 255, 255, 255, 255 };
+const SDL_Color black = { 0, 0, 0, 255 };
+const SDL_Color buttonColor = { 255, 255, 255, 128 };
+
+void renderTextPerCall(SDL_Renderer* renderer, TTF_Font* font, const string& text, float x, float y, SDL_Color color) {
+    SDL_Surface* textSurface = TTF_RenderUTF8_Solid(font, text.c_str(), color);
+    SDL_Texture* textTexture = SDL_CreateTextureFromSurface(renderer, textSurface);
+    const SDL_FRect textRect = { x, y, static_cast<float>(textSurface->w), static_cast<float>(textSurface->h) };
+    SDL_RenderCopyF(renderer, textTexture, nullptr, &textRect);
+    SDL_FreeSurface(textSurface);
+    SDL_DestroyTexture(textTexture);
+}
+
+SDL_FRect buttonRectPerCall(TTF_Font* font, const Button& button) {
+    int textWidth, textHeight;
+    TTF_SizeText(font, button.text.c_str(), &textWidth, &textHeight);
+    return { button.x - padding, button.y - padding / 2, static_cast<float>(textWidth + padding * 2), static_cast<float>(textHeight + padding) };
+}
+
+SDL_FRect buttonRectAtlas(const GlyphAtlas& atlas, const Button& button) {
+    return { button.x - padding, button.y - padding / 2, static_cast<float>(atlas.textWidth(button.text) + padding * 2), static_cast<float>(atlas.lineHeight() + padding) };
+}
+
+// One start screen frame as renderStartScreen draws it, with the hover test on each button
+template<typename RectFn, typename TextFn>
+void renderStartScreen(SDL_Renderer* renderer, SDL_Texture* background, const Button (&buttons)[2], RectFn&& rectOf, TextFn&& text) {
+    SDL_RenderClear(renderer);
+    SDL_RenderCopyF(renderer, background, nullptr, nullptr);
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 64);
+    SDL_RenderFillRect(renderer, nullptr);
+    text("Super Mario", SCREEN_WIDTH / 2 - 140, SCREEN_HEIGHT / 2 - 64, white);
+    for (const Button& button : buttons) {
+        doNotOptimize(rectOf(button)); // the hover test
+        SDL_FRect rect = rectOf(button);
+        SDL_SetRenderDrawColor(renderer, buttonColor.r, buttonColor.g, buttonColor.b, buttonColor.a);
+        SDL_RenderFillRectF(renderer, &rect);
+        text(button.text, button.x, button.y, black);
+    }
+    SDL_RenderPresent(renderer);
+}
+
+} // namespace
+
+void benchStartScreen() {
+    SDL_SetHint(SDL_HINT_VIDEODRIVER, "dummy");
+    if (SDL_Init(SDL_INIT_VIDEO) != 0 || TTF_Init() != 0) {
+        printf("skipped: %s\n", SDL_GetError());
+        return;
+    }
+    SDL_Window* window = SDL_CreateWindow("bench", 0, 0, SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_HIDDEN);
+    SDL_Renderer* renderer = window ? SDL_CreateRenderer(window, -1, SDL_RENDERER_SOFTWARE) : nullptr;
+    TTF_Font* font = TTF_OpenFont("../resources/font/firacode.ttf", 24);
+    GlyphAtlas atlas;
+    if (!renderer || !font || !atlas.build(renderer, font)) {
+        printf("skipped: no renderer or font (run from the build directory) %s\n", SDL_GetError());
+    } else {
+        SDL_Texture* background = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC, SCREEN_WIDTH, SCREEN_HEIGHT);
+        const Button buttons[2] = { { "Play", SCREEN_WIDTH / 2 - 44, SCREEN_HEIGHT / 2 - 16 }, { "Settings", SCREEN_WIDTH / 2 - 88, SCREEN_HEIGHT / 2 + 32 } };
+        constexpr size_t frames = 2000;
+
+        double perCall = timeNs(frames, [&] {
+            renderStartScreen(renderer, background, buttons, [&](const Button& b) { return buttonRectPerCall(font, b); },
+                              [&](const string& s, float x, float y, SDL_Color c) { renderTextPerCall(renderer, font, s, x, y, c); });
+        });
+        double atlased = timeNs(frames, [&] {
+            renderStartScreen(renderer, background, buttons, [&](const Button& b) { return buttonRectAtlas(atlas, b); },
+                              [&](const string& s, float x, float y, SDL_Color c) { atlas.draw(renderer, s, x, y, c); });
+        });
+        report("start screen frame, per-call text", perCall);
+        report("start screen frame, glyph atlas", atlased);
+        printf("%-48s %14.0f fps\n", "start screen, per-call text", 1e9 / perCall);
+        printf("%-48s %14.0f fps\n", "start screen, glyph atlas", 1e9 / atlased);
+
+        // One renderText call for a HUD line, without the rest of the frame
+        const string hudLine = "Coins: 12/40  Lives: 3  01:23";
+        report("renderText HUD line, per-call text", timeNs(frames, [&] { renderTextPerCall(renderer, font, hudLine, 10, 10, white); }));
+        report("renderText HUD line, glyph atlas", timeNs(frames * 10, [&] { atlas.draw(renderer, hudLine, 10, 10, white); }));
+        SDL_DestroyTexture(background);
+    }
+    atlas.destroy();
+    if (font) {
+        TTF_CloseFont(font);
+    }
+    if (renderer) {
+        SDL_DestroyRenderer(renderer);
+    }
+    if (window) {
+        SDL_DestroyWindow(window);
+    }
+    TTF_Quit();
+    SDL_Quit();
+}
@@ -0,0 +1,128 @@
+// Compares the per-frame physics queries against a linear scan of gameObjects (how they
+// worked before the tile grid) on generated levels of increasing size.
+#include <random>
+#include <string>
+#include <vector>
+#include "bench.h"
+#include "../level.h"
+
+using namespace std;
+
+namespace {
+
+constexpr int levelRows = 15;
+
+// Fills level with random tiles and makes every chunk resident, so the grid and the scan see the same objects
+void generateLevel(Level& level, vector<GameObject>& allObjects, int tiles, mt19937& rng) {
+    LevelData data;
+    LevelFileHeader& header = data.header;
+    header.cols = tiles / levelRows;
+    header.rows = levelRows;
+    header.playerCol = header.doorCol = -1;
+    data.tiles.assign(tileBytes(header), TILE_EMPTY);
+
+    uniform_int_distribution<int> roll(0, 99);
+    for (uint32_t row = 0; row < header.rows; ++row) {
+        for (uint32_t col = 0; col < header.cols; ++col) {
+            int r = roll(rng);
+            data.tiles[tileOffset(header, col, row)] = r < 30 ? TILE_BRICK : r < 40 ? TILE_VINE : r < 45 ? TILE_COIN : r < 46 ? TILE_LIFE : TILE_EMPTY;
+        }
+    }
+
+    vector<const Sprite*> sprites(8, nullptr); // the queries go by kind, never look at sprites
+    vector<const Sprite*> playerSprites(7, nullptr);
+    loadLevelData(std::move(data), level, sprites, playerSprites);
+    streamChunks(level, { 0, 0, level.width(), level.height() });
+
+    allObjects.clear();
+    for (const Chunk* chunk : level.residentChunks) {
+        allObjects.insert(allObjects.end(), chunk->gameObjects.begin(), chunk->gameObjects.end());
+    }
+}
+
+bool scanIsOnPlatform(const GameObject& player, const vector<GameObject>& gameObjects) {
+    SDL_FRect belowPlayer = player.rect;
+    belowPlayer.y += 1;
+    for (const auto& obj : gameObjects) { //NOLINT(readability-use-anyofallof)
+        if (obj.kind == OBJECT_BRICK && hasIntersection(belowPlayer, obj.rect)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool scanIsOnVine(const GameObject& player, const vector<GameObject>& gameObjects) {
+    for (const auto& obj : gameObjects) { //NOLINT(readability-use-anyofallof)
+        if (obj.kind == OBJECT_VINE && hasIntersection(player.rect, obj.rect)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool scanIsAtTopOfVine(const GameObject& player, const vector<GameObject>& gameObjects) {
+    SDL_FRect belowPlayer = player.rect;
+    belowPlayer.y += 1;
+    for (const auto& obj : gameObjects) { //NOLINT(readability-use-anyofallof)
+        if (obj.kind == OBJECT_VINE && hasIntersection(belowPlayer, obj.rect)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool scanCollides(const SDL_FRect& newRect, const vector<GameObject>& gameObjects) {
+    for (const auto& obj : gameObjects) { //NOLINT(readability-use-anyofallof)
+        if (obj.kind != OBJECT_VINE && obj.kind != OBJECT_COIN && hasIntersection(newRect, obj.rect)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool gridCollides(const SDL_FRect& newRect, const Level& level) {
+    return level.any(newRect, [&](const Chunk& chunk, int32_t i) {
+        const GameObject& obj = chunk.gameObjects[i];
+        return obj.kind != OBJECT_VINE && obj.kind != OBJECT_COIN && hasIntersection(newRect, obj.rect);
+    });
+}
+
+} // namespace
+
+void benchTileGrid() {
+    mt19937 rng(42);
+    for (int tiles : { 1000, 100000, 1000000 }) {
+        Level level;
+        vector<GameObject> allObjects;
+        generateLevel(level, allObjects, tiles, rng);
+
+        // Player rects at random, non tile-aligned positions, like they are mid-fall
+        vector<GameObject> players(256);
+        uniform_real_distribution<float> px(0, static_cast<float>(level.header.cols - 1) * TILE_SIZE);
+        uniform_real_distribution<float> py(0, (levelRows - 1) * TILE_SIZE);
+        for (auto& p : players) {
+            p = { nullptr, { px(rng), py(rng), TILE_SIZE, TILE_SIZE }, OBJECT_PLAYER };
+        }
+
+        // Keep the linear scan to a similar total amount of work on every size
+        size_t scanIterations = max<size_t>(8, 20000000 / allObjects.size());
+        size_t gridIterations = 1000000;
+        size_t next = 0;
+
+        string suffix = " (" + to_string(tiles) + " tiles)";
+        report("scan  isOnPlatform+isOnVine+atTop+collide" + suffix, timeNs(scanIterations, [&] {
+            const GameObject& p = players[next++ & 255];
+            doNotOptimize(scanIsOnPlatform(p, allObjects) + scanIsOnVine(p, allObjects) +
+                          scanIsAtTopOfVine(p, allObjects) + scanCollides(p.rect, allObjects));
+        }));
+        report("grid  isOnPlatform+isOnVine+atTop+collide" + suffix, timeNs(gridIterations, [&] {
+            const GameObject& p = players[next++ & 255];
+            doNotOptimize(isOnPlatform(p, level) + isOnVine(p, level) +
+                          isAtTopOfVine(p, level) + gridCollides(p.rect, level));
+        }));
+        report("grid  sweepTiles, a tile right and down" + suffix, timeNs(gridIterations, [&] {
+            const GameObject& p = players[next++ & 255];
+            doNotOptimize(sweepTiles(level, p.rect, TILE_SIZE, TILE_SIZE).time);
+        }));
+    }
+}
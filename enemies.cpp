@@ -0,0 +1,221 @@
+// ReSharper disable CppLocalVariableMayBeConst
+#include "enemies.h"
+#include <algorithm>
+#include <future>
+#include "profiler.h"
+#include "simd.h"
+#include "threadpool.h"
+
+#ifdef SIMD_X86
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+// Below this many enemies per thread a task costs more than it saves
+constexpr size_t minEnemiesPerTask = 16384;
+constexpr size_t npos = EnemySet::npos;
+static_assert(npos == noIntersection);
+
+// index in a subspan starting at begin, as an index in the whole set
+size_t offset(size_t index, size_t begin) {
+    return index == npos ? npos : index + begin;
+}
+
+template<typename Fn>
+void forEachArray(EnemyArrays& a, Fn&& fn) {
+    fn(a.x);
+    fn(a.previousX);
+    fn(a.y);
+    fn(a.w);
+    fn(a.h);
+    fn(a.pathStart);
+    fn(a.pathEnd);
+    fn(a.speed);
+    fn(a.direction);
+    fn(a.frame);
+}
+
+// Patrol kernels, each moving the enemies in [begin, end). The vector ones leave the last few to
+// the scalar one. All of them use the same float operations in the same order, so the positions
+// never depend on the instruction set.
+
+void patrolScalar(EnemyArrays& a, size_t begin, size_t end, float dt) {
+    for (size_t i = begin; i < end; ++i) {
+        float x = a.x[i];
+        a.previousX[i] = x;
+        float moved = x + a.direction[i] * (a.speed[i] * dt);
+        if (a.direction[i] > 0 ? moved >= a.pathEnd[i] : moved <= a.pathStart[i]) {
+            a.direction[i] = -a.direction[i];
+        }
+        a.frame[i] ^= moved != x;
+        a.x[i] = moved;
+    }
+}
+
+#ifdef SIMD_X86
+__attribute__((target("sse2")))
+void patrolSse2(EnemyArrays& a, size_t begin, size_t end, float dt) {
+    const __m128 step = _mm_set1_ps(dt);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 sign = _mm_set1_ps(-0.0f);
+    const __m128i frameBit = _mm_set1_epi32(1);
+    size_t i = begin;
+    for (; i + 4 <= end; i += 4) {
+        __m128 x = _mm_loadu_ps(&a.x[i]);
+        _mm_storeu_ps(&a.previousX[i], x);
+        __m128 direction = _mm_loadu_ps(&a.direction[i]);
+        __m128 moved = _mm_add_ps(x, _mm_mul_ps(direction, _mm_mul_ps(_mm_loadu_ps(&a.speed[i]), step)));
+        __m128 movingRight = _mm_cmpgt_ps(direction, zero);
+        __m128 turn = _mm_or_ps(_mm_and_ps(movingRight, _mm_cmpge_ps(moved, _mm_loadu_ps(&a.pathEnd[i]))),
+                                _mm_andnot_ps(movingRight, _mm_cmple_ps(moved, _mm_loadu_ps(&a.pathStart[i]))));
+        _mm_storeu_ps(&a.direction[i], _mm_xor_ps(direction, _mm_and_ps(turn, sign)));
+        auto* frame = reinterpret_cast<__m128i*>(&a.frame[i]);
+        __m128i flipped = _mm_and_si128(_mm_castps_si128(_mm_cmpneq_ps(moved, x)), frameBit);
+        _mm_storeu_si128(frame, _mm_xor_si128(_mm_loadu_si128(frame), flipped));
+        _mm_storeu_ps(&a.x[i], moved);
+    }
+    patrolScalar(a, i, end, dt);
+}
+
+// No FMA on purpose: a fused multiply-add rounds differently from the other kernels
+__attribute__((target("avx2")))
+void patrolAvx2(EnemyArrays& a, size_t begin, size_t end, float dt) {
+    const __m256 step = _mm256_set1_ps(dt);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 sign = _mm256_set1_ps(-0.0f);
+    const __m256i frameBit = _mm256_set1_epi32(1);
+    size_t i = begin;
+    for (; i + 8 <= end; i += 8) {
+        __m256 x = _mm256_loadu_ps(&a.x[i]);
+        _mm256_storeu_ps(&a.previousX[i], x);
+        __m256 direction = _mm256_loadu_ps(&a.direction[i]);
+        __m256 moved = _mm256_add_ps(x, _mm256_mul_ps(direction, _mm256_mul_ps(_mm256_loadu_ps(&a.speed[i]), step)));
+        __m256 movingRight = _mm256_cmp_ps(direction, zero, _CMP_GT_OQ);
+        __m256 turn = _mm256_or_ps(_mm256_and_ps(movingRight, _mm256_cmp_ps(moved, _mm256_loadu_ps(&a.pathEnd[i]), _CMP_GE_OQ)),
+                                   _mm256_andnot_ps(movingRight, _mm256_cmp_ps(moved, _mm256_loadu_ps(&a.pathStart[i]), _CMP_LE_OQ)));
+        _mm256_storeu_ps(&a.direction[i], _mm256_xor_ps(direction, _mm256_and_ps(turn, sign)));
+        auto* frame = reinterpret_cast<__m256i*>(&a.frame[i]);
+        __m256i flipped = _mm256_and_si256(_mm256_castps_si256(_mm256_cmp_ps(moved, x, _CMP_NEQ_UQ)), frameBit);
+        _mm256_storeu_si256(frame, _mm256_xor_si256(_mm256_loadu_si256(frame), flipped));
+        _mm256_storeu_ps(&a.x[i], moved);
+    }
+    patrolScalar(a, i, end, dt);
+}
+#endif
+
+void patrol(EnemyArrays& a, size_t begin, size_t end, float dt) {
+    switch (simdLevel()) {
+#ifdef SIMD_X86
+    case SIMD_AVX2:
+        patrolAvx2(a, begin, end, dt);
+        break;
+    case SIMD_SSE2:
+        patrolSse2(a, begin, end, dt);
+        break;
+#endif
+    default:
+        patrolScalar(a, begin, end, dt);
+        break;
+    }
+}
+
+// Runs kernel(begin, end) over [0, count) in one piece per pool thread, this one taking the
+// first, and returns the smallest result, so the first match in order like a single pass would
+template<typename Kernel>
+size_t firstInParallel(size_t count, ThreadPool* pool, Kernel&& kernel) {
+    size_t tasks = pool ? min(pool->size(), count / minEnemiesPerTask) : 1;
+    if (tasks <= 1) {
+        return kernel(0, count);
+    }
+    // Pieces start on a cache line boundary of the arrays, so no two threads write to the same line
+    size_t piece = (count / tasks + 15) & ~static_cast<size_t>(15);
+    vector<future<size_t>> others;
+    for (size_t begin = piece; begin < count; begin += piece) {
+        others.push_back(pool->submit([&kernel, begin, end = min(count, begin + piece)] { return kernel(begin, end); }));
+    }
+    size_t first = kernel(0, min(count, piece));
+    for (auto& other : others) {
+        first = min(first, other.get());
+    }
+    return first;
+}
+
+} // namespace
+
+EnemySet::EnemySet(Arena* arena) : index_(arena) {
+    forEachArray(arrays_, [arena](auto& array) {
+        using Array = remove_reference_t<decltype(array)>;
+        array = Array(typename Array::allocator_type(arena));
+    });
+}
+
+EnemySet::Handle EnemySet::add(const SDL_FRect& rect, const SDL_FRect& path, float speed) {
+    arrays_.x.push_back(rect.x);
+    arrays_.previousX.push_back(rect.x);
+    arrays_.y.push_back(rect.y);
+    arrays_.w.push_back(rect.w);
+    arrays_.h.push_back(rect.h);
+    arrays_.pathStart.push_back(path.x);
+    arrays_.pathEnd.push_back(path.x + path.w);
+    arrays_.speed.push_back(speed);
+    arrays_.direction.push_back(1);
+    arrays_.frame.push_back(0);
+    return index_.add();
+}
+
+bool EnemySet::remove(Handle handle) {
+    size_t i = index_.find(handle);
+    if (i == npos) {
+        return false;
+    }
+    removeAt(i);
+    return true;
+}
+
+void EnemySet::removeAt(size_t i) {
+    forEachArray(arrays_, [i](auto& array) {
+        array[i] = array.back();
+        array.pop_back();
+    });
+    index_.removeAt(i);
+}
+
+void EnemySet::clear() {
+    forEachArray(arrays_, [](auto& array) { array.clear(); });
+    index_.clear();
+}
+
+void EnemySet::reserve(size_t count) {
+    forEachArray(arrays_, [count](auto& array) { array.reserve(count); });
+    index_.reserve(count);
+}
+
+RectSpan EnemySet::rects() const {
+    return { arrays_.x.data(), arrays_.y.data(), arrays_.w.data(), arrays_.h.data(), size() };
+}
+
+size_t EnemySet::update(const SDL_FRect& player, float dt, ThreadPool* pool) {
+    firstInParallel(size(), pool, [&](size_t begin, size_t end) {
+        PROFILE_ZONE("enemy patrol");
+        patrol(arrays_, begin, end, dt);
+        return npos;
+    });
+    // The bottom edge of the player against the top pixel row of every enemy
+    SDL_FRect feet = { player.x, player.y + player.h, player.w, 1 };
+    RectSpan tops = { arrays_.x.data(), arrays_.y.data(), arrays_.w.data(), nullptr, size(), 1 };
+    return firstInParallel(size(), pool, [&](size_t begin, size_t end) {
+        PROFILE_ZONE("enemy stomp test");
+        return offset(firstIntersection(feet, tops.subspan(begin, end)), begin);
+    });
+}
+
+bool EnemySet::anyOverlapping(const SDL_FRect& rect, ThreadPool* pool) const {
+    RectSpan all = rects();
+    return firstInParallel(size(), pool, [&](size_t begin, size_t end) {
+        PROFILE_ZONE("enemy overlap test");
+        return offset(firstIntersection(rect, all.subspan(begin, end)), begin);
+    }) != npos;
+}
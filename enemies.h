@@ -0,0 +1,73 @@
+#pragma once
+#include <SDL2/SDL.h>
+#include <cstdint>
+#include <vector>
+#include "aabb.h"
+#include "arena.h"
+#include "game.h"
+#include "slotindex.h"
+
+class ThreadPool;
+
+// What the kernels work on, one array per field, every array size() long
+struct EnemyArrays {
+    ArenaVector<float> x;
+    ArenaVector<float> previousX; // before the last tick, rendering interpolates from here
+    ArenaVector<float> y;
+    ArenaVector<float> w;
+    ArenaVector<float> h;
+    ArenaVector<float> pathStart; // the patrol turns around at these x
+    ArenaVector<float> pathEnd;
+    ArenaVector<float> speed;
+    ArenaVector<float> direction; // 1 moving right, -1 moving left
+    ArenaVector<uint32_t> frame; // 0 drawn with spriteLeft, 1 with spriteRight
+};
+
+// Every enemy of a level, as a structure of arrays so that each tick runs as vector kernels over
+// the float arrays, split across worker threads when there are enough enemies. Positions are not
+// stable, removing an enemy moves the last one into its place, Handles are.
+class EnemySet {
+public:
+    using Handle = SlotIndex::Handle;
+    static constexpr size_t npos = SlotIndex::npos;
+
+    // Shared by every enemy, they alternate between the two with every step
+    const Sprite* spriteLeft = nullptr;
+    const Sprite* spriteRight = nullptr;
+
+    EnemySet() = default;
+    // Keeps every array in arena, which has to outlive the set. Reserve the enemies up front, the
+    // arena never gets back what the arrays outgrow.
+    explicit EnemySet(Arena* arena);
+
+    // The enemy starts at rect, moving right, and patrols between path.x and path.x + path.w
+    Handle add(const SDL_FRect& rect, const SDL_FRect& path, float speed);
+    // False when handle's enemy was already removed
+    bool remove(Handle handle);
+    void removeAt(size_t i);
+    void clear();
+    void reserve(size_t count);
+
+    [[nodiscard]] size_t size() const { return index_.size(); }
+    [[nodiscard]] bool empty() const { return index_.size() == 0; }
+    [[nodiscard]] Handle handleAt(size_t i) const { return index_.handleAt(i); }
+    // npos once handle's enemy was removed
+    [[nodiscard]] size_t find(Handle handle) const { return index_.find(handle); }
+
+    [[nodiscard]] SDL_FRect rect(size_t i) const { return { arrays_.x[i], arrays_.y[i], arrays_.w[i], arrays_.h[i] }; }
+    [[nodiscard]] SDL_FRect previousRect(size_t i) const { return { arrays_.previousX[i], arrays_.y[i], arrays_.w[i], arrays_.h[i] }; }
+    [[nodiscard]] bool movingRight(size_t i) const { return arrays_.direction[i] > 0; }
+    [[nodiscard]] const Sprite* sprite(size_t i) const { return arrays_.frame[i] ? spriteRight : spriteLeft; }
+    // Every enemy's current rect, for the batch tests in aabb.h
+    [[nodiscard]] RectSpan rects() const;
+
+    // Moves every enemy dt seconds along its path. Returns the first enemy whose top the bottom
+    // edge of player touches once moved, npos when there is none. pool may be nullptr.
+    size_t update(const SDL_FRect& player, float dt, ThreadPool* pool);
+    // Whether any enemy overlaps rect
+    [[nodiscard]] bool anyOverlapping(const SDL_FRect& rect, ThreadPool* pool) const;
+
+private:
+    SlotIndex index_;
+    EnemyArrays arrays_;
+};
@@ -0,0 +1,155 @@
+// ReSharper disable CppLocalVariableMayBeConst
+#include "framepacer.h"
+#include <algorithm>
+#include <thread>
+#include "profiler.h"
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/resource.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+// Sleeps are never trusted to wake up closer to the deadline than this
+constexpr chrono::nanoseconds minSpinMargin = chrono::microseconds(200);
+
+// User and kernel time of every thread of the process
+double processCpuSeconds() {
+#ifdef _WIN32
+    FILETIME created, exited, kernel, user;
+    GetProcessTimes(GetCurrentProcess(), &created, &exited, &kernel, &user);
+    auto ticks = [](const FILETIME& time) { return static_cast<double>(static_cast<uint64_t>(time.dwHighDateTime) << 32 | time.dwLowDateTime); };
+    return (ticks(kernel) + ticks(user)) / 1e7; // 100 ns ticks
+#else
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    auto seconds = [](const timeval& time) { return static_cast<double>(time.tv_sec) + static_cast<double>(time.tv_usec) / 1e6; };
+    return seconds(usage.ru_utime) + seconds(usage.ru_stime);
+#endif
+}
+
+double percentOf(double cpuSeconds, chrono::steady_clock::duration wall) {
+    double wallSeconds = chrono::duration<double>(wall).count();
+    return wallSeconds > 0 ? cpuSeconds * 100 / wallSeconds : 0;
+}
+
+} // namespace
+
+bool parsePacingMode(const string& name, PacingMode& mode) {
+    for (PacingMode candidate : { PACING_VSYNC, PACING_CAP, PACING_UNCAPPED }) {
+        if (name == pacingModeName(candidate)) {
+            mode = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* pacingModeName(PacingMode mode) {
+    switch (mode) {
+    case PACING_VSYNC:
+        return "vsync";
+    case PACING_CAP:
+        return "cap";
+    default:
+        return "uncapped";
+    }
+}
+
+void FrameTimes::add(double ms) {
+    size_t bucket = min(static_cast<size_t>(ms / bucketMs), buckets_.size() - 1);
+    ++buckets_[bucket];
+    ++frames_;
+    sumMs_ += ms;
+    maxMs_ = max(maxMs_, ms);
+}
+
+void FrameTimes::clear() {
+    *this = FrameTimes();
+}
+
+FrameTimes::Summary FrameTimes::summary() const {
+    Summary summary;
+    summary.frames = frames_;
+    if (frames_ == 0) {
+        return summary;
+    }
+    summary.meanMs = sumMs_ / static_cast<double>(frames_);
+    summary.maxMs = maxMs_;
+    // The first bucket by which 99% of the frames are counted
+    uint64_t target = (frames_ * 99 + 99) / 100;
+    uint64_t counted = 0;
+    for (size_t i = 0; i < buckets_.size(); ++i) {
+        counted += buckets_[i];
+        if (counted >= target) {
+            summary.p99Ms = min(static_cast<double>(i + 1) * bucketMs, maxMs_);
+            break;
+        }
+    }
+    return summary;
+}
+
+FramePacer::FramePacer(PacingMode mode, int fps) : mode_(mode), fps_(max(fps, 1)) {
+    period_ = chrono::duration_cast<Clock::duration>(chrono::duration<double>(1.0 / fps_));
+    spinMargin_ = chrono::milliseconds(1);
+    start_ = windowStart_ = lastFrameEnd_ = Clock::now();
+    deadline_ = start_ + period_;
+    startCpuSeconds_ = windowCpuSeconds_ = processCpuSeconds();
+}
+
+void FramePacer::waitUntil(Clock::time_point deadline) {
+    PROFILE_ZONE("frame pacing");
+    Clock::duration requested = deadline - Clock::now() - spinMargin_;
+    if (requested > Clock::duration::zero()) {
+        Clock::time_point before = Clock::now();
+        this_thread::sleep_for(requested);
+        Clock::duration overslept = Clock::now() - before - requested;
+        // Follow the worst recent oversleep, letting it decay slowly so one late wake-up does not
+        // keep the spin long for good
+        spinMargin_ = clamp<Clock::duration>(max(overslept, spinMargin_ - spinMargin_ / 16), minSpinMargin, period_);
+    }
+    // Give the core away while spinning, other processes on the machine may want it
+    while (Clock::now() < deadline) {
+        this_thread::yield();
+    }
+}
+
+void FramePacer::endFrame() {
+    if (mode_ == PACING_CAP) {
+        waitUntil(deadline_);
+        deadline_ += period_;
+        // A frame that ran more than a whole period late starts a new schedule instead of being
+        // followed by a burst of unpaced ones
+        if (Clock::time_point now = Clock::now(); now > deadline_) {
+            deadline_ = now + period_;
+        }
+    }
+
+    Clock::time_point now = Clock::now();
+    double ms = chrono::duration<double, milli>(now - lastFrameEnd_).count();
+    lastFrameEnd_ = now;
+    window_.add(ms);
+    total_.add(ms);
+
+    if (now - windowStart_ >= chrono::seconds(1)) {
+        double cpuSeconds = processCpuSeconds();
+        lastSecond_ = { window_.summary(), percentOf(cpuSeconds - windowCpuSeconds_, now - windowStart_) };
+        window_.clear();
+        windowStart_ = now;
+        windowCpuSeconds_ = cpuSeconds;
+    }
+}
+
+void FramePacer::skipFrame() {
+    lastFrameEnd_ = Clock::now();
+    deadline_ = lastFrameEnd_ + period_;
+}
+
+FramePacer::Stats FramePacer::total() const {
+    return { total_.summary(), percentOf(processCpuSeconds() - startCpuSeconds_, Clock::now() - start_) };
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+enum PacingMode {
+    PACING_VSYNC, // SDL_RenderPresent waits for the display's refresh
+    PACING_CAP, // sleeps, then spins, up to the next frame's deadline
+    PACING_UNCAPPED // never waits, for benchmarking
+};
+
+// "vsync", "cap" or "uncapped". Returns false, leaving mode untouched, for anything else.
+bool parsePacingMode(const std::string& name, PacingMode& mode);
+const char* pacingModeName(PacingMode mode);
+
+// Frame times counted into fixed 0.1 ms buckets, so adding one and reading a percentile cost the
+// same however long the game runs
+class FrameTimes {
+public:
+    struct Summary {
+        uint64_t frames = 0;
+        double meanMs = 0;
+        double p99Ms = 0; // the upper edge of its bucket
+        double maxMs = 0;
+    };
+
+    void add(double ms);
+    void clear();
+    [[nodiscard]] Summary summary() const;
+
+private:
+    static constexpr double bucketMs = 0.1;
+    std::array<uint32_t, 1000> buckets_{}; // frames of 100 ms or longer all land in the last one
+    uint64_t frames_ = 0;
+    double sumMs_ = 0;
+    double maxMs_ = 0;
+};
+
+// Ends every frame the way its mode asks and measures the time between frames and how much of
+// it the process spent on a CPU. In PACING_CAP the sleep stops short of the deadline by about as
+// much as sleeps have recently overslept, and spins the rest, so frames end on time without
+// spinning any longer than the scheduler makes necessary.
+class FramePacer {
+public:
+    struct Stats {
+        FrameTimes::Summary times;
+        double cpuPercent = 0; // of one core, above 100 when several threads were busy
+    };
+
+    FramePacer(PacingMode mode, int fps);
+
+    [[nodiscard]] PacingMode mode() const { return mode_; }
+    [[nodiscard]] int fps() const { return fps_; }
+
+    // Call once per frame, after presenting it
+    void endFrame();
+    // Call instead of endFrame when the loop waited for input without drawing. The wait is not
+    // counted as a frame and the next frame's deadline starts from now.
+    void skipFrame();
+
+    // The last whole second, refreshed once a second, for the stats overlay
+    [[nodiscard]] const Stats& lastSecond() const { return lastSecond_; }
+    // Every frame since the pacer was created
+    [[nodiscard]] Stats total() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    void waitUntil(Clock::time_point deadline);
+
+    PacingMode mode_;
+    int fps_;
+    Clock::duration period_;
+    Clock::duration spinMargin_;
+    Clock::time_point deadline_;
+    Clock::time_point lastFrameEnd_;
+
+    FrameTimes window_;
+    Clock::time_point windowStart_;
+    double windowCpuSeconds_;
+    Stats lastSecond_;
+
+    FrameTimes total_;
+    Clock::time_point start_;
+    double startCpuSeconds_;
+};
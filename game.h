@@ -0,0 +1,47 @@
+#pragma once
+#include <SDL2/SDL.h>
+
+#define SCREEN_WIDTH 800
+#define SCREEN_HEIGHT 600
+#define TILE_SIZE 40
+
+// Gameplay advances in fixed ticks of 1 / TICK_RATE seconds, however fast frames are drawn
+#define TICK_RATE 120
+constexpr float TICK_SECONDS = 1.0f / TICK_RATE;
+
+// Speeds in pixels per second. The loop used to move things a fixed step per iteration,
+// these keep the feel it had at about a thousand iterations per second.
+#define ENEMY_SPEED 50.0f
+#define FALL_SPEED 800.0f
+#define JUMP_FALL_SPEED 40.0f
+#define LANDED_FALL_SPEED 150.0f
+
+struct Sprite;
+
+// What a GameObject is. Physics and pickups go by this, the sprite is only for drawing.
+// The tile kinds have the values of their TileKind.
+enum ObjectKind : uint8_t {
+    OBJECT_NONE,
+    OBJECT_BRICK,
+    OBJECT_VINE,
+    OBJECT_COIN,
+    OBJECT_LIFE,
+    OBJECT_PLAYER,
+    OBJECT_DOOR,
+    OBJECT_ENEMY
+};
+
+struct GameObject {
+    const Sprite* sprite;
+    SDL_FRect rect;
+    ObjectKind kind;
+};
+
+
+inline bool hasIntersection(const SDL_FRect& A, const SDL_FRect& B) {
+    if (A.x + A.w <= B.x || B.x + B.w <= A.x || A.y + A.h <= B.y || B.y + B.h <= A.y) {
+        return false;
+    }
+
+    return true;
+}
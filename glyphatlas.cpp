@@ -0,0 +1,155 @@
+// ReSharper disable CppLocalVariableMayBeConst
+#include "glyphatlas.h"
+#include "renderstats.h"
+
+using namespace std;
+
+namespace {
+
+constexpr int atlasWidth = 512;
+constexpr int glyphPadding = 1; // keeps filtering from bleeding one glyph into the next
+
+// Decodes the code point starting at text[pos] and moves pos past it. Malformed bytes come out as '?'.
+uint32_t nextCodepoint(string_view text, size_t& pos) {
+    auto lead = static_cast<uint8_t>(text[pos++]);
+    if (lead < 0x80) {
+        return lead;
+    }
+    int length = lead >= 0xf0 ? 3 : lead >= 0xe0 ? 2 : lead >= 0xc0 ? 1 : 0;
+    if (length == 0) {
+        return '?';
+    }
+    uint32_t codepoint = lead & (0x3f >> length);
+    for (int i = 0; i < length; ++i) {
+        if (pos >= text.size() || (static_cast<uint8_t>(text[pos]) & 0xc0) != 0x80) {
+            return '?';
+        }
+        codepoint = codepoint << 6 | (static_cast<uint8_t>(text[pos++]) & 0x3f);
+    }
+    return codepoint;
+}
+
+} // namespace
+
+GlyphAtlas::~GlyphAtlas() {
+    destroy();
+}
+
+void GlyphAtlas::destroy() {
+    if (texture_) {
+        SDL_DestroyTexture(texture_);
+        texture_ = nullptr;
+    }
+    glyphs_.clear();
+}
+
+bool GlyphAtlas::build(SDL_Renderer* renderer, TTF_Font* font) {
+    destroy();
+    if (!font) {
+        return false;
+    }
+    lineHeight_ = TTF_FontHeight(font);
+
+    // Render every glyph in white, so drawing can tint it with the vertex colour
+    vector<SDL_Surface*> surfaces;
+    glyphs_.resize(lastGlyph - firstGlyph + 1);
+    int x = 0;
+    int y = 0;
+    int rowHeight = 0;
+    for (uint32_t codepoint = firstGlyph; codepoint <= lastGlyph; ++codepoint) {
+        Glyph& glyph = glyphs_[codepoint - firstGlyph];
+        glyph = { { 0, 0, 0, 0 }, 0 };
+        SDL_Surface* surface = nullptr;
+        int minX, maxX, minY, maxY;
+        if (TTF_GlyphIsProvided32(font, codepoint) && TTF_GlyphMetrics32(font, codepoint, &minX, &maxX, &minY, &maxY, &glyph.advance) == 0) {
+            surface = TTF_RenderGlyph32_Blended(font, codepoint, { 255, 255, 255, 255 });
+        }
+        surfaces.push_back(surface);
+        if (!surface) {
+            continue;
+        }
+        if (x + surface->w > atlasWidth) {
+            x = 0;
+            y += rowHeight + glyphPadding;
+            rowHeight = 0;
+        }
+        glyph.source = { x, y, surface->w, surface->h };
+        x += surface->w + glyphPadding;
+        rowHeight = max(rowHeight, surface->h);
+    }
+
+    SDL_Surface* atlas = SDL_CreateRGBSurfaceWithFormat(0, atlasWidth, max(y + rowHeight, 1), 32, SDL_PIXELFORMAT_RGBA32);
+    if (atlas) {
+        SDL_FillRect(atlas, nullptr, 0);
+        for (size_t i = 0; i < surfaces.size(); ++i) {
+            if (surfaces[i]) {
+                // Copy the glyph's alpha as it is instead of blending it onto the empty atlas
+                SDL_SetSurfaceBlendMode(surfaces[i], SDL_BLENDMODE_NONE);
+                SDL_BlitSurface(surfaces[i], nullptr, atlas, &glyphs_[i].source);
+            }
+        }
+        texture_ = SDL_CreateTextureFromSurface(renderer, atlas);
+        textureWidth_ = static_cast<float>(atlas->w);
+        textureHeight_ = static_cast<float>(atlas->h);
+        SDL_FreeSurface(atlas);
+    }
+    for (SDL_Surface* surface : surfaces) {
+        SDL_FreeSurface(surface);
+    }
+    if (!texture_) {
+        glyphs_.clear();
+        return false;
+    }
+    SDL_SetTextureBlendMode(texture_, SDL_BLENDMODE_BLEND);
+    return true;
+}
+
+const GlyphAtlas::Glyph& GlyphAtlas::glyph(uint32_t codepoint) const {
+    if (codepoint < firstGlyph || codepoint > lastGlyph || glyphs_[codepoint - firstGlyph].advance == 0) {
+        codepoint = '?';
+    }
+    return glyphs_[codepoint - firstGlyph];
+}
+
+int GlyphAtlas::textWidth(string_view text) const {
+    if (glyphs_.empty()) {
+        return 0;
+    }
+    int width = 0;
+    for (size_t pos = 0; pos < text.size();) {
+        width += glyph(nextCodepoint(text, pos)).advance;
+    }
+    return width;
+}
+
+void GlyphAtlas::draw(SDL_Renderer* renderer, string_view text, float x, float y, SDL_Color color) {
+    if (!texture_) {
+        return;
+    }
+    vertices_.clear();
+    indices_.clear();
+    for (size_t pos = 0; pos < text.size();) {
+        const Glyph& g = glyph(nextCodepoint(text, pos));
+        if (g.source.w > 0) {
+            float u0 = g.source.x / textureWidth_;
+            float v0 = g.source.y / textureHeight_;
+            float u1 = (g.source.x + g.source.w) / textureWidth_;
+            float v1 = (g.source.y + g.source.h) / textureHeight_;
+            auto w = static_cast<float>(g.source.w);
+            auto h = static_cast<float>(g.source.h);
+            int first = static_cast<int>(vertices_.size());
+            vertices_.push_back({ { x, y }, color, { u0, v0 } });
+            vertices_.push_back({ { x + w, y }, color, { u1, v0 } });
+            vertices_.push_back({ { x + w, y + h }, color, { u1, v1 } });
+            vertices_.push_back({ { x, y + h }, color, { u0, v1 } });
+            for (int corner : { 0, 1, 2, 0, 2, 3 }) {
+                indices_.push_back(first + corner);
+            }
+        }
+        x += static_cast<float>(g.advance);
+    }
+    if (!indices_.empty()) {
+        SDL_RenderGeometry(renderer, texture_, vertices_.data(), static_cast<int>(vertices_.size()), indices_.data(), static_cast<int>(indices_.size()));
+        renderStats.draw(texture_);
+    }
+}
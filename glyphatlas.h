@@ -0,0 +1,45 @@
+#pragma once
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+#include <string_view>
+#include <vector>
+
+// Every Latin-1 glyph of a font rendered once into a single texture, with its metrics. A string
+// is drawn as one SDL_RenderGeometry batch of quads, instead of a surface and a texture per call.
+class GlyphAtlas {
+public:
+    GlyphAtlas() = default;
+    ~GlyphAtlas();
+
+    GlyphAtlas(const GlyphAtlas&) = delete;
+    GlyphAtlas& operator=(const GlyphAtlas&) = delete;
+
+    // Returns false, leaving the atlas empty, if the glyphs could not be rendered
+    bool build(SDL_Renderer* renderer, TTF_Font* font);
+    void destroy();
+
+    [[nodiscard]] int lineHeight() const { return lineHeight_; }
+    // The same width TTF_SizeUTF8 reports, from the cached advances
+    [[nodiscard]] int textWidth(std::string_view text) const;
+
+    // Draws UTF-8 text with its top left corner at x, y. Characters outside Latin-1 are drawn as '?'.
+    void draw(SDL_Renderer* renderer, std::string_view text, float x, float y, SDL_Color color);
+
+private:
+    struct Glyph {
+        SDL_Rect source; // in the atlas texture, empty for glyphs the font lacks
+        int advance;
+    };
+    static constexpr uint32_t firstGlyph = 32;
+    static constexpr uint32_t lastGlyph = 255;
+
+    [[nodiscard]] const Glyph& glyph(uint32_t codepoint) const;
+
+    SDL_Texture* texture_ = nullptr;
+    float textureWidth_ = 0;
+    float textureHeight_ = 0;
+    int lineHeight_ = 0;
+    std::vector<Glyph> glyphs_; // firstGlyph..lastGlyph
+    std::vector<SDL_Vertex> vertices_; // kept between draws so a frame's text allocates nothing
+    std::vector<int> indices_;
+};
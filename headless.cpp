@@ -0,0 +1,190 @@
+// ReSharper disable CppLocalVariableMayBeConst
+#include "headless.h"
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include "replay.h"
+#include "session.h"
+#include "spriteatlas.h"
+#include "threadpool.h"
+
+using namespace std;
+
+namespace {
+
+// The session only compares and stores sprite pointers, so distinct empty sprites stand in for them
+Sprite placeholders[15];
+
+vector<const Sprite*> placeholderSprites(size_t first, size_t count) {
+    vector<const Sprite*> sprites;
+    for (size_t i = first; i < first + count; ++i) {
+        sprites.push_back(&placeholders[i]);
+    }
+    return sprites;
+}
+
+struct ScriptedKey {
+    uint64_t tick;
+    SDL_Keycode key;
+};
+
+// Four seconds of a player walking right, jumping over things, double jumping and backing off,
+// played on a loop. Keys are sorted by tick.
+constexpr uint64_t scriptTicks = TICK_RATE * 4;
+
+vector<ScriptedKey> benchScript() {
+    vector<ScriptedKey> script;
+    for (uint64_t tick = 0; tick < scriptTicks; tick += TICK_RATE / 4) {
+        script.push_back({ tick, SDLK_d });
+    }
+    script.push_back({ TICK_RATE + 1, SDLK_SPACE });
+    script.push_back({ TICK_RATE * 2 + 1, SDLK_SPACE });
+    script.push_back({ TICK_RATE * 2 + 20, SDLK_SPACE });
+    script.push_back({ TICK_RATE * 3 + 1, SDLK_a });
+    script.push_back({ TICK_RATE * 3 + 2, SDLK_w });
+    ranges::stable_sort(script, {}, &ScriptedKey::tick);
+    return script;
+}
+
+int usage() {
+    fprintf(stderr, "usage: marioSDL --headless --bench [--seconds N] [--levels DIR]\n"
+                    "       marioSDL --headless --replay FILE [--repeat N] [--levels DIR]\n");
+    return 2;
+}
+
+int replay(const string& path, int repeat, const vector<string>& levelFiles) {
+    Recording recording = readRecording(path);
+    ThreadPool workers;
+    double best = 0;
+    int64_t divergedAt = -1;
+    for (int run = 0; run < repeat; ++run) {
+        GameSession session;
+        initHeadlessSession(session, levelFiles, workers);
+        InputReplayer replayer(recording);
+        replayer.begin(session);
+
+        auto start = chrono::steady_clock::now();
+        while (!replayer.finished()) {
+            replayer.beforeTick(session);
+            session.tick();
+            session.audio.clear();
+            replayer.afterTick(session);
+        }
+        double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        best = run == 0 ? elapsed : min(best, elapsed);
+        divergedAt = replayer.divergedAt();
+        if (divergedAt >= 0) {
+            break;
+        }
+    }
+
+    uint64_t ticks = recording.hashes.size();
+    printf("%s: %llu ticks from %s, best of %d in %.3f ms (%.0f ticks/s)\n", path.c_str(), static_cast<unsigned long long>(ticks),
+           recording.levelName.c_str(), repeat, best * 1000, ticks / best);
+    if (divergedAt >= 0) {
+        printf("Diverged from the recording at tick %lld\n", static_cast<long long>(divergedAt));
+        return 1;
+    }
+    printf("Every tick matches the recording\n");
+    return 0;
+}
+
+} // namespace
+
+void initHeadlessSession(GameSession& session, const vector<string>& levelFiles, ThreadPool& workers) {
+    session.levelFiles = levelFiles;
+    session.workers = &workers;
+    session.sprites = placeholderSprites(0, 8);
+    session.playerSprites = placeholderSprites(8, 7);
+    session.levelLoader.setLogging(false);
+}
+
+int playScripted(GameSession& session, int index, uint64_t ticks) {
+    static const vector<ScriptedKey> script = benchScript();
+
+    // Dying or finishing starts the level over, so the whole run is spent in it
+    int restarts = 0;
+    size_t next = 0;
+    for (uint64_t tick = 0; tick < ticks; ++tick) {
+        uint64_t scriptTick = tick % scriptTicks;
+        if (scriptTick == 0) {
+            next = 0;
+        }
+        for (; next < script.size() && script[next].tick == scriptTick; ++next) {
+            session.keyDown(script[next].key);
+        }
+        session.tick();
+        session.audio.clear();
+        if (session.state == LOST || session.state == WON) {
+            ++restarts;
+            session.lives = 3;
+            session.noMoreLives = false;
+            session.startLevel(index);
+        }
+    }
+    return restarts;
+}
+
+int runHeadless(const vector<string>& args) {
+    bool bench = false;
+    string replayPath;
+    double seconds = 60;
+    int repeat = 1;
+    string levelsDir = "../levels";
+    for (size_t i = 0; i < args.size(); ++i) {
+        if (args[i] == "--bench") {
+            bench = true;
+        } else if (args[i] == "--replay" && i + 1 < args.size()) {
+            replayPath = args[++i];
+        } else if (args[i] == "--seconds" && i + 1 < args.size()) {
+            seconds = stod(args[++i]);
+        } else if (args[i] == "--repeat" && i + 1 < args.size()) {
+            repeat = stoi(args[++i]);
+        } else if (args[i] == "--levels" && i + 1 < args.size()) {
+            levelsDir = args[++i];
+        } else {
+            return usage();
+        }
+    }
+    if (bench == !replayPath.empty() || seconds <= 0 || repeat <= 0) {
+        return usage();
+    }
+
+    vector<string> levelFiles = getLevelFiles(levelsDir);
+    if (levelFiles.empty()) {
+        fprintf(stderr, "No levels in %s\n", levelsDir.c_str());
+        return 1;
+    }
+    if (!replayPath.empty()) {
+        try {
+            return replay(replayPath, repeat, levelFiles);
+        } catch (const exception& e) {
+            cerr << e.what() << endl;
+            return 1;
+        }
+    }
+
+    auto ticks = static_cast<uint64_t>(seconds * TICK_RATE);
+
+    ThreadPool workers;
+    printf("%-24s %16s %10s\n", "level", "ticks/s", "restarts");
+    uint64_t allTicks = 0;
+    double allSeconds = 0;
+    for (int index = 0; index < static_cast<int>(levelFiles.size()); ++index) {
+        GameSession session;
+        initHeadlessSession(session, levelFiles, workers);
+        session.startLevel(index);
+
+        auto start = chrono::steady_clock::now();
+        int restarts = playScripted(session, index, ticks);
+        double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        allTicks += ticks;
+        allSeconds += elapsed;
+
+        string name = filesystem::path(levelFiles[index]).filename().string();
+        printf("%-24s %16.0f %10d\n", name.c_str(), ticks / elapsed, restarts);
+    }
+    printf("%-24s %16.0f\n", "all", allTicks / allSeconds);
+    return 0;
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct GameSession;
+class ThreadPool;
+
+// Runs the simulation with no window, audio or font and returns the exit code.
+//   marioSDL --headless --bench [--seconds N] [--levels DIR]
+//     plays every level in DIR for N simulated seconds with a scripted player and prints the
+//     ticks per second each one runs at
+//   marioSDL --headless --replay FILE [--repeat N] [--levels DIR]
+//     replays a recording made with --record N times, checking it still plays out the same
+int runHeadless(const std::vector<std::string>& args);
+
+// Points session at levelFiles with stand-in textures, so it runs without a renderer
+void initHeadlessSession(GameSession& session, const std::vector<std::string>& levelFiles, ThreadPool& workers);
+// Plays level index for ticks ticks with the scripted player --bench uses, starting the level over
+// whenever it is lost or won. Returns how many times it was.
+int playScripted(GameSession& session, int index, uint64_t ticks);
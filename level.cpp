@@ -0,0 +1,420 @@
+// ReSharper disable CppParameterMayBeConst
+// ReSharper disable CppLocalVariableMayBeConst
+#include "level.h"
+#include "assetpack.h"
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+using namespace std;
+
+namespace {
+
+// Slot in the sprites vector for each TileKind, TILE_EMPTY never becomes an object
+constexpr size_t tileSpriteIndex[] = { 0, 0, 1, 2, 7 };
+// buildChunk turns tiles into objects by value
+static_assert(+OBJECT_BRICK == TILE_BRICK && +OBJECT_VINE == TILE_VINE && +OBJECT_COIN == TILE_COIN && +OBJECT_LIFE == TILE_LIFE);
+
+constexpr float chunkPixels = CHUNK_TILES * TILE_SIZE;
+
+// Levels load on the prefetch thread too
+atomic<uint32_t> lastStaticRevision = 0;
+const AssetPack* levelPack = nullptr;
+// Chunks are built once they come within loadMargin of the view and dropped once they are
+// further than evictMargin, the gap keeps a chunk from thrashing while the player paces on its edge
+constexpr float loadMargin = chunkPixels / 2;
+constexpr float evictMargin = chunkPixels * 1.5f;
+
+SDL_FRect expand(const SDL_FRect& rect, float margin) {
+    return { rect.x - margin, rect.y - margin, rect.w + margin * 2, rect.h + margin * 2 };
+}
+
+uint64_t tileKey(const LevelFileHeader& header, int col, int row) {
+    return static_cast<uint64_t>(row) * header.cols + col;
+}
+
+//NOLINTBEGIN(cppcoreguidelines-narrowing-conversions)
+void buildChunk(const Level& level, Chunk& chunk) {
+    const uint8_t* tiles = level.tiles + (static_cast<size_t>(chunk.row) * chunkCols(level.header) + chunk.col) * CHUNK_TILE_COUNT;
+    chunk.gameObjects.clear();
+    chunk.grid.reset(CHUNK_TILES, CHUNK_TILES);
+
+    for (int y = 0; y < CHUNK_TILES; ++y) {
+        for (int x = 0; x < CHUNK_TILES; ++x) {
+            uint8_t tile = tiles[y * CHUNK_TILES + x];
+            if (tile == TILE_EMPTY || tile > TILE_LIFE) {
+                continue;
+            }
+            int col = chunk.col * CHUNK_TILES + x;
+            int row = chunk.row * CHUNK_TILES + y;
+            if (!level.removedTiles.empty() && level.removedTiles.contains(tileKey(level.header, col, row))) {
+                continue;
+            }
+            SDL_FRect rect = { static_cast<float>(col * TILE_SIZE), static_cast<float>(row * TILE_SIZE), TILE_SIZE, TILE_SIZE };
+            chunk.grid.at(x, y) = static_cast<int32_t>(chunk.gameObjects.size());
+            chunk.gameObjects.push_back({ level.tileSprites[tile], rect, static_cast<ObjectKind>(tile) });
+        }
+    }
+}
+
+// What a level with this header takes from its arena, padding included, so that it loads into
+// a single block. parsed adds the tiles and enemy paths a text level is parsed into.
+size_t levelArenaBytes(const LevelFileHeader& header, bool parsed) {
+    size_t chunkCount = static_cast<size_t>(chunkCols(header)) * chunkRows(header);
+    size_t pickups = header.coinCount + header.lifeCount;
+    size_t bytes = chunkCount * sizeof(unique_ptr<Chunk>) +
+                   header.enemyCount * (sizeof(float) * 9 + sizeof(uint32_t) * 4) + // the enemy arrays and slots
+                   pickups * 32 + // removedTiles' buckets, and a node for each one picked up
+                   1024;
+    if (parsed) {
+        bytes += tileBytes(header) + header.enemyCount * sizeof(EnemyPath);
+    }
+    return bytes;
+}
+
+// Hands the chunks back to the pool, drops everything that lives in the arena and empties it,
+// sized for a level with header
+void releaseLevel(Level& level, const LevelFileHeader& header, bool parsed) {
+    for (auto& chunk : level.chunks) {
+        if (chunk) {
+            level.freeChunks.push_back(std::move(chunk));
+        }
+    }
+    level.chunks = decltype(level.chunks)();
+    level.residentChunks.clear();
+    level.removedTiles = Level::TileSet();
+    level.enemies = EnemySet();
+    level.tiles = nullptr;
+    if (!level.arena) { // moved from
+        level.arena = make_unique<Arena>();
+    }
+    level.arena->reset();
+    level.arena->reserve(levelArenaBytes(header, parsed));
+}
+
+// Resets the level around its new header and tiles, then creates the player, the door and
+// every enemy. Shared by the text and the compiled loaders, after releaseLevel.
+void initLevel(Level& level, const EnemyPath* enemyPaths, const vector<const Sprite*>& sprites, const vector<const Sprite*>& playerSprites) {
+    const LevelFileHeader& header = level.header;
+    Arena* arena = level.arena.get();
+    for (size_t kind = 0; kind <= TILE_LIFE; ++kind) {
+        level.tileSprites[kind] = sprites[tileSpriteIndex[kind]];
+    }
+
+    level.chunks = decltype(level.chunks)(static_cast<size_t>(chunkCols(header)) * chunkRows(header), ArenaAllocator<unique_ptr<Chunk>>(arena));
+    // Enough buckets that picking up every coin and life never rehashes
+    level.removedTiles = Level::TileSet(size_t{ header.coinCount } + header.lifeCount, hash<uint64_t>(), equal_to<uint64_t>(), ArenaAllocator<uint64_t>(arena));
+    level.staticRevision = ++lastStaticRevision;
+    level.totalCoins = static_cast<int>(header.coinCount);
+
+    if (header.playerCol >= 0) {
+        SDL_FRect rect = { static_cast<float>(header.playerCol * TILE_SIZE), static_cast<float>(header.playerRow * TILE_SIZE), TILE_SIZE, TILE_SIZE };
+        level.player = { playerSprites[1], rect, OBJECT_PLAYER };
+    }
+    if (header.doorCol >= 0) {
+        SDL_FRect rect = { static_cast<float>(header.doorCol * TILE_SIZE), static_cast<float>((header.doorRow - 1) * TILE_SIZE), TILE_SIZE, TILE_SIZE * 2 };
+        level.door = { sprites[5], rect, OBJECT_DOOR };
+    }
+
+    // Create enemies and their movement paths
+    level.enemies = EnemySet(arena);
+    level.enemies.reserve(header.enemyCount);
+    level.enemies.spriteLeft = sprites[3];
+    level.enemies.spriteRight = sprites[4];
+    for (uint32_t i = 0; i < header.enemyCount; ++i) {
+        const EnemyPath& p = enemyPaths[i];
+        float y = p.row * TILE_SIZE;
+        float startX = p.startCol * TILE_SIZE;
+        float endX = p.endCol * TILE_SIZE;
+        float enemySize = TILE_SIZE * 0.75; // 25% smaller than TILE_SIZE
+        float yOffset = TILE_SIZE - enemySize; // Calculate the offset to align to the bottom
+        SDL_FRect enemyRect = { startX, y + yOffset, enemySize, enemySize };
+        SDL_FRect path = { startX, y, endX - startX, TILE_SIZE };
+        level.enemies.add(enemyRect, path, ENEMY_SPEED);
+    }
+
+    streamChunks(level, cameraView(level, level.player));
+    level.loadStats = arena->stats();
+}
+//NOLINTEND(cppcoreguidelines-narrowing-conversions)
+
+bool isTileInLevel(const LevelFileHeader& header, int32_t col, int32_t row) {
+    return col >= 0 && row >= 0 && static_cast<uint32_t>(col) < header.cols && static_cast<uint32_t>(row) < header.rows;
+}
+
+// What initLevel relies on and parseLevelText guarantees, checked for files it did not just write
+const char* compiledLevelError(const LevelFileHeader& header, const EnemyPath* enemyPaths) {
+    if (size_t{ header.coinCount } + header.lifeCount > header.objectCount || header.objectCount > uint64_t{ header.cols } * header.rows) {
+        return "object counts do not fit the level";
+    }
+    if (header.playerCol != -1 && !isTileInLevel(header, header.playerCol, header.playerRow)) {
+        return "player is outside the level";
+    }
+    if (header.doorCol != -1 && !isTileInLevel(header, header.doorCol, header.doorRow)) {
+        return "door is outside the level";
+    }
+    for (uint32_t i = 0; i < header.enemyCount; ++i) {
+        const EnemyPath& p = enemyPaths[i];
+        if (!isTileInLevel(header, p.startCol, p.row) || !isTileInLevel(header, p.endCol, p.row) || p.startCol > p.endCol) {
+            return "enemy path is outside the level";
+        }
+    }
+    return nullptr;
+}
+
+} // namespace
+
+SDL_FRect chunkRect(const Chunk& chunk) {
+    return { chunk.col * chunkPixels, chunk.row * chunkPixels, chunkPixels, chunkPixels };
+}
+
+bool loadCompiledLevel(const string& path, Level& level, const vector<const Sprite*>& sprites, const vector<const Sprite*>& playerSprites, uint64_t sourceHash) {
+    MappedFile file(path);
+    if (!file.isOpen() || !loadCompiledLevel(file.data(), file.size(), path, level, sprites, playerSprites, sourceHash)) {
+        return false;
+    }
+    // The chunks read their tiles straight out of the mapping, so the level keeps it open
+    level.file = std::move(file);
+    return true;
+}
+
+bool loadCompiledLevel(const uint8_t* data, size_t size, const string& name, Level& level, const vector<const Sprite*>& sprites, const vector<const Sprite*>& playerSprites,
+                       uint64_t sourceHash) {
+    if (size < sizeof(LevelFileHeader)) {
+        return false;
+    }
+    LevelFileHeader header;
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, levelFileMagic, sizeof(header.magic)) != 0 || header.version != levelFileVersion) {
+        cerr << "Ignoring " << name << ": not a version " << levelFileVersion << " compiled level" << endl;
+        return false;
+    }
+    if (sourceHash != 0 && header.sourceHash != sourceHash) {
+        cerr << "Ignoring " << name << ": compiled from another text file" << endl;
+        return false;
+    }
+    size_t pathsOffset = enemyPathsOffset(header);
+    if (size < pathsOffset + header.enemyCount * sizeof(EnemyPath)) {
+        cerr << "Ignoring " << name << ": file is truncated" << endl;
+        return false;
+    }
+    const auto* enemyPaths = reinterpret_cast<const EnemyPath*>(data + pathsOffset);
+    if (const char* error = compiledLevelError(header, enemyPaths)) {
+        cerr << "Ignoring " << name << ": " << error << endl;
+        return false;
+    }
+
+    releaseLevel(level, header, false);
+    level.header = header;
+    level.file = MappedFile();
+    level.tiles = data + sizeof(LevelFileHeader);
+    initLevel(level, enemyPaths, sprites, playerSprites);
+    return true;
+}
+
+void setLevelPack(const AssetPack* pack) {
+    levelPack = pack;
+}
+
+void loadLevelData(LevelData&& data, Level& level, const vector<const Sprite*>& sprites, const vector<const Sprite*>& playerSprites) {
+    releaseLevel(level, data.header, true);
+    auto* tiles = level.arena->allocateArray<uint8_t>(data.tiles.size());
+    memcpy(tiles, data.tiles.data(), data.tiles.size());
+    level.header = data.header;
+    level.file = MappedFile();
+    level.tiles = tiles;
+    initLevel(level, data.enemyPaths.data(), sprites, playerSprites);
+}
+
+void loadLevelText(const string& filePath, Level& level, const vector<const Sprite*>& sprites, const vector<const Sprite*>& playerSprites) {
+    // Parsed straight out of the mapping into the arena, the only heap allocations are the
+    // arena's own block, and none when it is already big enough
+    MappedFile file(filePath);
+    string_view text(reinterpret_cast<const char*>(file.data()), file.size());
+    LevelTextShape shape = measureLevelText(text); // throws before the old level is touched
+
+    LevelFileHeader sized{};
+    sized.cols = shape.cols;
+    sized.rows = shape.rows;
+    sized.enemyCount = shape.enemyMarkers / 2;
+    sized.coinCount = shape.pickups;
+    releaseLevel(level, sized, true);
+    auto* tiles = level.arena->allocateArray<uint8_t>(tileBytes(sized));
+    auto* enemyPaths = level.arena->allocateArray<EnemyPath>(sized.enemyCount);
+    level.header = parseLevelText(text, shape, tiles, enemyPaths);
+    level.file = MappedFile();
+    level.tiles = tiles;
+    initLevel(level, enemyPaths, sprites, playerSprites);
+}
+
+void loadLevel(const string& filePath, Level& level, const vector<const Sprite*>& sprites, const vector<const Sprite*>& playerSprites) {
+    if (const AssetPackEntry* entry = levelPack ? levelPack->find(filePath) : nullptr; entry && entry->kind == ASSET_LEVEL &&
+        loadCompiledLevel(levelPack->data(*entry), entry->size, filePath, level, sprites, playerSprites)) {
+        return;
+    }
+    // Prefer the compiled level unless the text file was edited after it was built
+    // and only when it was compiled from this very file
+    string compiledPath = compiledLevelPath(filePath);
+    error_code compiledError, textError;
+    auto compiledTime = filesystem::last_write_time(compiledPath, compiledError);
+    auto textTime = filesystem::last_write_time(filePath, textError);
+    if (!compiledError && (textError || compiledTime >= textTime) &&
+        loadCompiledLevel(compiledPath, level, sprites, playerSprites, levelSourceHash(filePath))) {
+        return;
+    }
+    loadLevelText(filePath, level, sprites, playerSprites);
+}
+
+vector<string> getLevelFiles(const string& folderPath) {
+    vector<string> levelFiles;
+
+    for (const auto& entry : filesystem::directory_iterator(folderPath)) {
+        if (entry.path().extension() == ".lvl") {
+            levelFiles.push_back(entry.path().string());
+        }
+    }
+
+    // Manual bubble sort
+    for (size_t i = 0; i < levelFiles.size(); ++i) {
+        for (size_t j = 0; j < levelFiles.size() - i - 1; ++j) {
+            if (levelFiles[j] > levelFiles[j + 1]) {
+                swap(levelFiles[j], levelFiles[j + 1]);
+            }
+        }
+    }
+    return levelFiles;
+}
+
+SDL_FRect cameraView(const Level& level, const GameObject& player) {
+    SDL_FRect view = { player.rect.x + player.rect.w / 2 - SCREEN_WIDTH / 2, player.rect.y + player.rect.h / 2 - SCREEN_HEIGHT / 2, SCREEN_WIDTH, SCREEN_HEIGHT }; // NOLINT(*-integer-division)
+    view.x = clamp(view.x, 0.0f, level.width() - SCREEN_WIDTH);
+    view.y = clamp(view.y, 0.0f, level.height() - SCREEN_HEIGHT);
+    return view;
+}
+
+void streamChunks(Level& level, const SDL_FRect& view) {
+    if (level.chunks.empty()) {
+        return;
+    }
+    int cols = static_cast<int>(chunkCols(level.header));
+
+    SDL_FRect keep = expand(view, evictMargin);
+    for (size_t i = 0; i < level.residentChunks.size();) {
+        Chunk* chunk = level.residentChunks[i];
+        if (hasIntersection(chunkRect(*chunk), keep)) {
+            ++i;
+            continue;
+        }
+        level.freeChunks.push_back(std::move(level.chunks[static_cast<size_t>(chunk->row) * cols + chunk->col]));
+        level.residentChunks[i] = level.residentChunks.back();
+        level.residentChunks.pop_back();
+    }
+
+    SDL_FRect load = expand(view, loadMargin);
+    int col0 = max(0, static_cast<int>(floor(load.x / chunkPixels)));
+    int row0 = max(0, static_cast<int>(floor(load.y / chunkPixels)));
+    int col1 = min(cols - 1, static_cast<int>(floor((load.x + load.w) / chunkPixels)));
+    int row1 = min(static_cast<int>(chunkRows(level.header)) - 1, static_cast<int>(floor((load.y + load.h) / chunkPixels)));
+    for (int row = row0; row <= row1; ++row) {
+        for (int col = col0; col <= col1; ++col) {
+            unique_ptr<Chunk>& slot = level.chunks[static_cast<size_t>(row) * cols + col];
+            if (slot) {
+                continue;
+            }
+            if (level.freeChunks.empty()) {
+                slot = make_unique<Chunk>();
+            } else {
+                slot = std::move(level.freeChunks.back());
+                level.freeChunks.pop_back();
+            }
+            slot->col = col;
+            slot->row = row;
+            buildChunk(level, *slot);
+            level.residentChunks.push_back(slot.get());
+        }
+    }
+}
+
+void removeGameObject(Level& level, Chunk& chunk, int32_t index) {
+    vector<GameObject>& gameObjects = chunk.gameObjects;
+    auto localCell = [&](const SDL_FRect& rect) -> int32_t& {
+        return chunk.grid.at(static_cast<int>(rect.x / TILE_SIZE) - chunk.col * CHUNK_TILES, static_cast<int>(rect.y / TILE_SIZE) - chunk.row * CHUNK_TILES);
+    };
+
+    const SDL_FRect& rect = gameObjects[index].rect;
+    if (level.isStatic(gameObjects[index])) {
+        level.staticRevision = ++lastStaticRevision;
+    }
+    level.removedTiles.insert(tileKey(level.header, static_cast<int>(rect.x / TILE_SIZE), static_cast<int>(rect.y / TILE_SIZE)));
+    localCell(rect) = -1;
+    if (index != static_cast<int32_t>(gameObjects.size()) - 1) {
+        gameObjects[index] = gameObjects.back();
+        localCell(gameObjects[index].rect) = index;
+    }
+    gameObjects.pop_back();
+}
+
+bool isOnVine(const GameObject& player, const Level& level) {
+    return level.any(player.rect, [&](const Chunk& chunk, int32_t i) {
+        const GameObject& obj = chunk.gameObjects[i];
+        return obj.kind == OBJECT_VINE && hasIntersection(player.rect, obj.rect);
+    });
+}
+
+bool isAtTopOfVine(const GameObject& player, const Level& level) {
+    SDL_FRect belowPlayer = player.rect;
+    belowPlayer.y += 1;
+    return level.any(belowPlayer, [&](const Chunk& chunk, int32_t i) {
+        const GameObject& obj = chunk.gameObjects[i];
+        return obj.kind == OBJECT_VINE && hasIntersection(belowPlayer, obj.rect);
+    });
+}
+
+bool isOnPlatform(const GameObject& player, const Level& level) {
+    SDL_FRect belowPlayer = player.rect;
+    belowPlayer.y += 1; // Check just below the player
+    return level.any(belowPlayer, [&](const Chunk& chunk, int32_t i) {
+        const GameObject& obj = chunk.gameObjects[i];
+        return obj.kind == OBJECT_BRICK && hasIntersection(belowPlayer, obj.rect);
+    });
+}
+
+SweepHit sweepTiles(const Level& level, const SDL_FRect& rect, float dx, float dy) {
+    SDL_FRect swept = { min(rect.x, rect.x + dx), min(rect.y, rect.y + dy), rect.w + fabs(dx), rect.h + fabs(dy) };
+    SweepHit first;
+    level.any(swept, [&](const Chunk& chunk, int32_t i) {
+        const GameObject& obj = chunk.gameObjects[i];
+        if (obj.kind == OBJECT_BRICK) {
+            if (SweepHit hit = sweep(rect, dx, dy, obj.rect); hit.time < first.time) {
+                first = hit;
+            }
+        }
+        return false;
+    });
+    return first;
+}
+
+SweepHit moveAndSlide(const Level& level, SDL_FRect& rect, float dx, float dy) {
+    SweepHit first = sweepTiles(level, rect, dx, dy);
+    SweepHit hit = first;
+    // Each touch stops the move along one axis, so it is over after two
+    for (int touches = 0; touches < 2 && hit.time < 1; ++touches) {
+        float remaining = 1 - hit.time;
+        if (hit.normalX != 0) {
+            rect.x = hit.edge;
+            rect.y += dy * hit.time;
+            dx = 0;
+            dy *= remaining;
+        } else {
+            rect.x += dx * hit.time;
+            rect.y = hit.edge;
+            dx *= remaining;
+            dy = 0;
+        }
+        hit = sweepTiles(level, rect, dx, dy);
+    }
+    rect.x += dx * hit.time;
+    rect.y += dy * hit.time;
+    return first;
+}
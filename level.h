@@ -0,0 +1,138 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include "arena.h"
+#include "enemies.h"
+#include "game.h"
+#include "levelformat.h"
+#include "mappedfile.h"
+#include "tilegrid.h"
+
+class AssetPack;
+
+// The resident objects of one CHUNK_TILES x CHUNK_TILES block of the level. The grid indexes
+// gameObjects, so objects must only be removed through removeGameObject.
+struct Chunk {
+    int col = 0; // position in chunks, not in tiles
+    int row = 0;
+    std::vector<GameObject> gameObjects;
+    TileGrid grid;
+};
+
+// Everything loadLevel builds for one level. Tiles live in the chunk-major tile array (mapped
+// from the compiled file, or parsed from text) and are only turned into GameObjects for the
+// chunks around the camera, see streamChunks. Enemies, the player and the door are always resident.
+// Whatever only lives as long as the level, parsed tiles, enemies, the chunk table and the
+// removed tiles, is carved from its arena, which the next load empties in one go. Chunks are
+// pooled across levels instead, their number is bounded by the view.
+struct Level {
+    using TileSet = std::unordered_set<uint64_t, std::hash<uint64_t>, std::equal_to<uint64_t>, ArenaAllocator<uint64_t>>;
+
+    // First, so it goes last. On the heap, so the containers pointing at it survive swapping levels.
+    std::unique_ptr<Arena> arena = std::make_unique<Arena>();
+    Arena::Stats loadStats; // what the arena held once the level had loaded
+
+    LevelFileHeader header{};
+    MappedFile file;
+    const uint8_t* tiles = nullptr; // into file, the arena or the level pack
+    const Sprite* tileSprites[TILE_LIFE + 1] = {};
+
+    ArenaVector<std::unique_ptr<Chunk>> chunks; // chunkCols x chunkRows, null when not resident
+    std::vector<Chunk*> residentChunks;
+    std::vector<std::unique_ptr<Chunk>> freeChunks; // evicted chunks kept for reuse
+    TileSet removedTiles; // picked up coins and lives, so they stay gone after eviction
+    // Unique across all levels, changes whenever a brick or vine could have: on load and when one is removed.
+    // Anything drawn from the static tiles is stale once it differs.
+    uint32_t staticRevision = 0;
+
+    EnemySet enemies;
+    GameObject player{};
+    GameObject door{};
+    int totalCoins = 0;
+
+    // Levels smaller than the window still fill it
+    [[nodiscard]] float width() const { return std::max(static_cast<float>(header.cols * TILE_SIZE), static_cast<float>(SCREEN_WIDTH)); }
+    [[nodiscard]] float height() const { return std::max(static_cast<float>(header.rows * TILE_SIZE), static_cast<float>(SCREEN_HEIGHT)); }
+
+    // Bricks and vines never move or get picked up
+    [[nodiscard]] bool isStatic(const GameObject& obj) const {
+        return obj.kind == OBJECT_BRICK || obj.kind == OBJECT_VINE;
+    }
+
+    [[nodiscard]] Chunk* chunkAt(int col, int row) const {
+        return chunks[static_cast<size_t>(row) * chunkCols(header) + col].get();
+    }
+
+    // Calls fn(chunk, index) for every resident object whose tile overlaps rect, in row-major
+    // tile order. Stops and returns true as soon as fn returns true.
+    template<typename Fn>
+    bool any(const SDL_FRect& rect, Fn&& fn) const {
+        // A tile [c, c + 1) * TILE_SIZE overlaps rect when it starts before rect ends and ends
+        // after rect starts, the same strict test hasIntersection uses
+        int col0 = std::max(0, static_cast<int>(std::floor(rect.x / TILE_SIZE)));
+        int row0 = std::max(0, static_cast<int>(std::floor(rect.y / TILE_SIZE)));
+        int col1 = std::min(static_cast<int>(header.cols) - 1, static_cast<int>(std::ceil((rect.x + rect.w) / TILE_SIZE)) - 1);
+        int row1 = std::min(static_cast<int>(header.rows) - 1, static_cast<int>(std::ceil((rect.y + rect.h) / TILE_SIZE)) - 1);
+        for (int row = row0; row <= row1; ++row) {
+            for (int col = col0; col <= col1; ++col) {
+                Chunk* chunk = chunkAt(col / CHUNK_TILES, row / CHUNK_TILES);
+                if (!chunk) {
+                    continue;
+                }
+                int32_t index = chunk->grid.at(col % CHUNK_TILES, row % CHUNK_TILES);
+                if (index >= 0 && fn(*chunk, index)) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+};
+
+// Loads filePath from the level pack when it has an entry by that name. Otherwise loads
+// levels/<name>.lvlb (see levelformat.h) when it is up to date, or else parses the text file.
+// The chunks around the player's spawn are streamed in before returning.
+void loadLevel(const std::string& filePath, Level& level, const std::vector<const Sprite*>& sprites, const std::vector<const Sprite*>& playerSprites);
+void loadLevelText(const std::string& filePath, Level& level, const std::vector<const Sprite*>& sprites, const std::vector<const Sprite*>& playerSprites);
+void loadLevelData(LevelData&& data, Level& level, const std::vector<const Sprite*>& sprites, const std::vector<const Sprite*>& playerSprites);
+// Returns false, leaving level untouched, if the file is missing or not a valid compiled level, or
+// when sourceHash is not 0 and the level was not compiled from the text file with that levelSourceHash
+bool loadCompiledLevel(const std::string& path, Level& level, const std::vector<const Sprite*>& sprites, const std::vector<const Sprite*>& playerSprites,
+                       uint64_t sourceHash = 0);
+// The same from a compiled level already in memory, which has to outlive level. name is only for the error messages.
+bool loadCompiledLevel(const uint8_t* data, size_t size, const std::string& name, Level& level, const std::vector<const Sprite*>& sprites,
+                       const std::vector<const Sprite*>& playerSprites, uint64_t sourceHash = 0);
+
+// Where loadLevel looks first, nullptr for none. Set it before any level loads, the prefetch thread reads it too.
+void setLevelPack(const AssetPack* pack);
+
+// The .lvl files in folderPath, sorted by name
+std::vector<std::string> getLevelFiles(const std::string& folderPath);
+
+// The area a chunk covers, in level pixels
+SDL_FRect chunkRect(const Chunk& chunk);
+
+// The window-sized view centred on the player, kept inside the level
+SDL_FRect cameraView(const Level& level, const GameObject& player);
+
+// Builds the chunks near view and evicts the ones far from it. Resident memory is bounded by
+// the view size, not the level size.
+void streamChunks(Level& level, const SDL_FRect& view);
+
+// O(1) swap-remove, the chunk's last object takes the removed one's slot
+void removeGameObject(Level& level, Chunk& chunk, int32_t index);
+
+bool isOnVine(const GameObject& player, const Level& level);
+bool isAtTopOfVine(const GameObject& player, const Level& level);
+bool isOnPlatform(const GameObject& player, const Level& level);
+
+// The first brick rect touches moving by (dx, dy). Only visits the tiles the move passes over,
+// so it costs the same on any size of level.
+SweepHit sweepTiles(const Level& level, const SDL_FRect& rect, float dx, float dy);
+// Moves rect by (dx, dy), stopping where it touches a brick and sliding along it for the rest
+// of the move. Returns the first touch.
+SweepHit moveAndSlide(const Level& level, SDL_FRect& rect, float dx, float dy);
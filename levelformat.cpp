@@ -0,0 +1,154 @@
+#include "levelformat.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+using namespace std;
+
+namespace {
+
+// Calls fn(line) for every line of text, without its line ending. Like getline, a last line
+// without a newline still counts and a trailing newline does not start another one.
+template<typename Fn>
+void forEachLine(string_view text, Fn&& fn) {
+    size_t start = 0;
+    while (start < text.size()) {
+        size_t end = min(text.find('\n', start), text.size());
+        string_view line = text.substr(start, end - start);
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        fn(line);
+        start = end + 1;
+    }
+}
+
+} // namespace
+
+LevelTextShape measureLevelText(string_view text) {
+    LevelTextShape shape;
+    bool player = false;
+    bool door = false;
+    forEachLine(text, [&](string_view line) {
+        shape.cols = max(shape.cols, static_cast<uint32_t>(line.length()));
+        ++shape.rows;
+        for (char c : line) {
+            if (c == '@') {
+                if (player) {
+                    throw runtime_error("Error: Player character initialized more than once!");
+                }
+                player = true;
+            } else if (c == 'D') {
+                if (door) {
+                    throw runtime_error("Error: More than one door initialized!");
+                }
+                door = true;
+            } else if (c == '$') {
+                ++shape.enemyMarkers;
+            } else if (c == '+' || c == '^') {
+                ++shape.pickups;
+            }
+        }
+    });
+    return shape;
+}
+
+LevelFileHeader parseLevelText(string_view text, const LevelTextShape& shape, uint8_t* tiles, EnemyPath* enemyPaths) {
+    LevelFileHeader header{};
+    memcpy(header.magic, levelFileMagic, sizeof(header.magic));
+    header.version = levelFileVersion;
+    header.cols = shape.cols;
+    header.rows = shape.rows;
+    header.playerCol = header.playerRow = -1;
+    header.doorCol = header.doorRow = -1;
+    memset(tiles, TILE_EMPTY, tileBytes(header));
+
+    int32_t y = 0;
+    forEachLine(text, [&](string_view line) {
+        int32_t pendingEnemy = -1;
+        for (int32_t x = 0; x < static_cast<int32_t>(line.length()); ++x) {
+            uint8_t& tile = tiles[tileOffset(header, x, y)];
+            switch (line[x]) {
+            case '1': tile = TILE_BRICK; break;
+            case '/': tile = TILE_VINE; break;
+            case '+': tile = TILE_COIN; ++header.coinCount; break;
+            case '^': tile = TILE_LIFE; ++header.lifeCount; break;
+            case '@':
+                header.playerCol = x;
+                header.playerRow = y;
+                break;
+            case 'D':
+                header.doorCol = x;
+                header.doorRow = y;
+                break;
+            case '$':
+                // '$' tiles pair up left to right, an unmatched last one is ignored
+                if (pendingEnemy < 0) {
+                    pendingEnemy = x;
+                } else {
+                    enemyPaths[header.enemyCount++] = { y, pendingEnemy, x };
+                    pendingEnemy = -1;
+                }
+                break;
+            default: break;
+            }
+            if (tile != TILE_EMPTY) {
+                ++header.objectCount;
+            }
+        }
+        ++y;
+    });
+    return header;
+}
+
+LevelData parseLevelText(istream& in) {
+    string text(istreambuf_iterator<char>(in), {});
+    LevelTextShape shape = measureLevelText(text);
+    LevelData data;
+    data.header.cols = shape.cols;
+    data.header.rows = shape.rows;
+    data.tiles.resize(tileBytes(data.header));
+    data.enemyPaths.resize(shape.enemyMarkers / 2);
+    data.header = parseLevelText(text, shape, data.tiles.data(), data.enemyPaths.data());
+    data.enemyPaths.resize(data.header.enemyCount);
+    return data;
+}
+
+string compiledLevelBytes(const LevelData& data) {
+    string bytes(reinterpret_cast<const char*>(&data.header), sizeof(data.header));
+    bytes.append(reinterpret_cast<const char*>(data.tiles.data()), data.tiles.size());
+    bytes.resize(enemyPathsOffset(data.header), '\0');
+    bytes.append(reinterpret_cast<const char*>(data.enemyPaths.data()), data.enemyPaths.size() * sizeof(EnemyPath));
+    return bytes;
+}
+
+void writeCompiledLevel(const LevelData& data, const string& outPath) {
+    ofstream out(outPath, ios::binary | ios::trunc);
+    if (!out) {
+        throw runtime_error("Error: Cannot write " + outPath);
+    }
+    string bytes = compiledLevelBytes(data);
+    out.write(bytes.data(), static_cast<streamsize>(bytes.size()));
+    if (!out) {
+        throw runtime_error("Error: Failed writing " + outPath);
+    }
+}
+
+string compiledLevelPath(const string& textPath) {
+    return (filesystem::path("levels") / filesystem::path(textPath).stem()).string() + ".lvlb";
+}
+
+uint64_t levelSourceHash(const string& textPath) {
+    error_code error;
+    filesystem::path path = filesystem::weakly_canonical(textPath, error);
+    string name = error ? textPath : path.string();
+    // FNV-1a, never 0 so that it cannot pass for a packed level's
+    uint64_t hash = 14695981039346656037ull;
+    for (char c : name) {
+        hash = (hash ^ static_cast<uint8_t>(c)) * 1099511628211ull;
+    }
+    return hash ? hash : 1;
+}
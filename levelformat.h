@@ -0,0 +1,109 @@
+#pragma once
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Compiled level (.lvlb) layout, written by levelc and memory-mapped by loadLevel:
+//   LevelFileHeader
+//   uint8_t tiles[chunkCols * chunkRows][CHUNK_TILES * CHUNK_TILES]
+//                                          TileKind, chunk after chunk, row-major inside a chunk
+//   EnemyPath enemyPaths[enemyCount]       starting at the next 4-byte boundary
+// Storing whole chunks contiguously lets the game stream one in with a single 1 KiB read.
+// Everything is stored in the host's byte order, the file is rebuilt with the game.
+
+constexpr char levelFileMagic[4] = { 'M', 'L', 'V', 'L' };
+constexpr uint32_t levelFileVersion = 3;
+
+// Levels are split into square chunks of this many tiles for streaming
+constexpr int CHUNK_TILES = 32;
+constexpr size_t CHUNK_TILE_COUNT = CHUNK_TILES * CHUNK_TILES;
+
+enum TileKind : uint8_t {
+    TILE_EMPTY,
+    TILE_BRICK,
+    TILE_VINE,
+    TILE_COIN,
+    TILE_LIFE
+};
+
+struct LevelFileHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t cols;
+    uint32_t rows;
+    uint32_t objectCount; // bricks, vines, coins and lives, the size of Level::gameObjects
+    uint32_t coinCount;
+    uint32_t lifeCount;
+    uint32_t enemyCount;
+    int32_t playerCol; // -1 when the level has no '@'
+    int32_t playerRow;
+    int32_t doorCol; // -1 when the level has no 'D'
+    int32_t doorRow;
+    uint64_t sourceHash; // levelSourceHash of the text file levelc compiled, 0 when packed
+};
+static_assert(sizeof(LevelFileHeader) == 56);
+
+// One '$' pair: the enemy patrols from startCol to endCol on row
+struct EnemyPath {
+    int32_t row;
+    int32_t startCol;
+    int32_t endCol;
+};
+
+inline uint32_t chunkCols(const LevelFileHeader& header) {
+    return (header.cols + CHUNK_TILES - 1) / CHUNK_TILES;
+}
+
+inline uint32_t chunkRows(const LevelFileHeader& header) {
+    return (header.rows + CHUNK_TILES - 1) / CHUNK_TILES;
+}
+
+inline size_t tileBytes(const LevelFileHeader& header) {
+    return static_cast<size_t>(chunkCols(header)) * chunkRows(header) * CHUNK_TILE_COUNT;
+}
+
+// Offset of a tile in the chunk-major tiles array
+inline size_t tileOffset(const LevelFileHeader& header, uint32_t col, uint32_t row) {
+    size_t chunk = static_cast<size_t>(row / CHUNK_TILES) * chunkCols(header) + col / CHUNK_TILES;
+    return chunk * CHUNK_TILE_COUNT + (row % CHUNK_TILES) * CHUNK_TILES + col % CHUNK_TILES;
+}
+
+// A level parsed from text, before any textures are attached
+struct LevelData {
+    LevelFileHeader header{};
+    std::vector<uint8_t> tiles;
+    std::vector<EnemyPath> enemyPaths;
+};
+
+LevelData parseLevelText(std::istream& in);
+
+// A first pass over a text level, enough to allocate what parseLevelText fills in. Throws if the
+// level has more than one '@' or 'D'.
+struct LevelTextShape {
+    uint32_t cols = 0;
+    uint32_t rows = 0;
+    uint32_t enemyMarkers = 0; // '$' tiles, there are at most half as many enemies
+    uint32_t pickups = 0; // '+' and '^' tiles
+};
+
+LevelTextShape measureLevelText(std::string_view text);
+// Fills tiles, tileBytes() of a cols x rows header long, and enemyPaths, with room for
+// shape.enemyMarkers / 2, and returns the header. Allocates nothing.
+LevelFileHeader parseLevelText(std::string_view text, const LevelTextShape& shape, uint8_t* tiles, EnemyPath* enemyPaths);
+
+inline size_t enemyPathsOffset(const LevelFileHeader& header) {
+    size_t end = sizeof(LevelFileHeader) + tileBytes(header);
+    return (end + 3) & ~static_cast<size_t>(3);
+}
+
+// The whole .lvlb file, for writing it out or packing it
+std::string compiledLevelBytes(const LevelData& data);
+void writeCompiledLevel(const LevelData& data, const std::string& outPath);
+
+// Where the build puts the compiled form of a text level: levels/<name>.lvlb under the working directory
+std::string compiledLevelPath(const std::string& textPath);
+// Identifies the text file at textPath by its absolute path, so a compiled level is only used in
+// place of the file it was compiled from and not of another one with the same name
+uint64_t levelSourceHash(const std::string& textPath);
@@ -0,0 +1,55 @@
+#include "levelloader.h"
+#include <chrono>
+#include <iostream>
+
+using namespace std;
+
+LevelLoader::~LevelLoader() {
+    discard();
+}
+
+void LevelLoader::discard() {
+    if (pending_.valid()) {
+        try {
+            pending_.get();
+        } catch (const exception&) {
+            // The level is not needed anymore, so neither is its error
+        }
+    }
+    pendingPath_.clear();
+}
+
+void LevelLoader::prefetch(const string& filePath, const vector<const Sprite*>& sprites, const vector<const Sprite*>& playerSprites) {
+    if (pending_.valid() && pendingPath_ == filePath && pendingSprites_ == sprites && pendingPlayerSprites_ == playerSprites) {
+        return;
+    }
+    discard();
+    pendingPath_ = filePath;
+    pendingSprites_ = sprites;
+    pendingPlayerSprites_ = playerSprites;
+    // The task gets its own copies of the sprite lists, the main thread may replace them meanwhile
+    pending_ = async(launch::async, [this, filePath, sprites, playerSprites] {
+        loadLevel(filePath, staging_, sprites, playerSprites);
+    });
+}
+
+bool LevelLoader::take(const string& filePath, Level& level, const vector<const Sprite*>& sprites, const vector<const Sprite*>& playerSprites) {
+    auto start = chrono::steady_clock::now();
+    // A level staged with the other character's sprites is useless after a character switch
+    bool prefetched = pending_.valid() && pendingPath_ == filePath && pendingSprites_ == sprites && pendingPlayerSprites_ == playerSprites;
+    if (prefetched) {
+        pendingPath_.clear();
+        pending_.get();
+        swap(level, staging_);
+    } else {
+        discard();
+        loadLevel(filePath, level, sprites, playerSprites);
+    }
+    lastSwitchMs_ = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    if (logging_) {
+        const Arena::Stats& stats = level.loadStats;
+        cout << "Level switch to " << filePath << " took " << lastSwitchMs_ << " ms" << (prefetched ? " (prefetched)" : "") << ", "
+             << stats.allocations << " arena allocations, " << stats.bytes / 1024.0 << " KiB, " << stats.heapBlocks << " new blocks" << endl;
+    }
+    return prefetched;
+}
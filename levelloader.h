@@ -0,0 +1,40 @@
+#pragma once
+#include <future>
+#include <string>
+#include <vector>
+#include "level.h"
+
+// Loads a level on a background thread into a staging Level, so the main thread only has to
+// swap it in when the player actually moves on. Used while the transition/dying fades play.
+class LevelLoader {
+public:
+    LevelLoader() = default;
+    ~LevelLoader();
+
+    LevelLoader(const LevelLoader&) = delete;
+    LevelLoader& operator=(const LevelLoader&) = delete;
+
+    // Starts loading filePath unless it is already being prefetched
+    void prefetch(const std::string& filePath, const std::vector<const Sprite*>& sprites, const std::vector<const Sprite*>& playerSprites);
+
+    // Swaps the prefetched level into level if it came from filePath with the same sprites,
+    // otherwise loads filePath synchronously. Returns true when the prefetch was used. Loader errors are rethrown here.
+    bool take(const std::string& filePath, Level& level, const std::vector<const Sprite*>& sprites, const std::vector<const Sprite*>& playerSprites);
+
+    // Milliseconds the last take() blocked the caller for
+    [[nodiscard]] double lastSwitchMs() const { return lastSwitchMs_; }
+
+    // Whether take() prints how long each switch took, on by default
+    void setLogging(bool enabled) { logging_ = enabled; }
+
+private:
+    void discard();
+
+    std::string pendingPath_;
+    std::vector<const Sprite*> pendingSprites_;
+    std::vector<const Sprite*> pendingPlayerSprites_;
+    std::future<void> pending_;
+    Level staging_;
+    double lastSwitchMs_ = 0;
+    bool logging_ = true;
+};
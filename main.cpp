@@ -4,168 +4,57 @@
 #include <SDL2/SDL_image.h>
 #include <SDL2/SDL_mixer.h>
 #include <SDL2/SDL_ttf.h>
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdio>
 #include <iostream>
 #include <vector>
 #include <string>
+#include <string_view>
+#include <cstring>
 #include <fstream>
 #include <filesystem>
+#include <optional>
 #include <thread>
-
-#define SCREEN_WIDTH 800
-#define SCREEN_HEIGHT 600
-#define TILE_SIZE 40
+#include <future>
+#include "level.h"
+#include "aabb.h"
+#include "alloccount.h"
+#include "assetcache.h"
+#include "assetpack.h"
+#include "backgrounds.h"
+#include "framepacer.h"
+#include "glyphatlas.h"
+#include "headless.h"
+#include "menulayer.h"
+#include "profiler.h"
+#include "renderstats.h"
+#include "replay.h"
+#include "session.h"
+#include "spriteatlas.h"
+#include "staticlayer.h"
+#include "threadpool.h"
 
 using namespace std;
 using namespace std::filesystem;
 
-struct GameObject {
-    SDL_Texture* texture;
-    SDL_FRect rect;
-};
-
-struct Enemy {
-    GameObject gameObject;
-    SDL_FRect path;
-    float speed;
-    bool movingRight;
-    SDL_Texture* textureLeft;
-    SDL_Texture* textureRight;
-    bool useLeftTexture;
-};
-
 struct Button {
     string text;
     float x;
     float y;
 };
 
-enum Character {
-    mario,
-    luigi,
-    none
-};
-
-Character playerChar = mario;
-
-enum GameState {
-    START_SCREEN,
-    SETTINGS,
-    ABOUT,
-    LEVEL_SELECT,
-    PLAYING,
-    TRANSITION,
-    WON,
-    DYING,
-    LOST,
-    MODE_SELECT
-};
-
-enum GameMode {
-    NORMAL,
-    CUSTOM
-};
-
-int totalCoins = 0;
-int collectedCoins = 0;
-
 TTF_Font* font = nullptr;
+GlyphAtlas textAtlas; // every string on screen is drawn from this, built from font once at startup
+SpriteAtlas spriteAtlas; // the level and player sprites, all loaded through it
+SpriteBatch spriteBatch; // world sprites queue here and go out in renderWorld's flush
+StaticLayerCache staticLayers; // bricks and vines of the resident chunks, baked into one texture per chunk
+MenuLayer menuLayer; // the current menu screen's backdrop
 SDL_Window* window = nullptr;
 SDL_Renderer* renderer = nullptr;
 
-int lives = 3;
-//int totalLives = 0;
-
 //NOLINTBEGIN(cppcoreguidelines-narrowing-conversions)
-void loadLevel(const string& filePath, vector<GameObject>& gameObjects, const vector<SDL_Texture*>& textures, const vector<SDL_Texture*>& playerTextures, vector<Enemy>& enemies, GameObject& player, GameObject& door) {
-    ifstream levelFile(filePath);
-    string line;
-    float y = 0;
-    bool playerInit = false;
-    bool doorInit = false;
-
-    while (getline(levelFile, line)) {
-        vector<int> enemyPositions;
-        for (int x = 0; x < line.length(); ++x) {
-            char tile = line[x];
-            SDL_FRect rect = { static_cast<float>(x * TILE_SIZE), y * TILE_SIZE, TILE_SIZE, TILE_SIZE };
-            if (tile == '1') {
-                gameObjects.push_back({ textures[1], rect });
-            } else if (tile == '/') {
-                gameObjects.push_back({ textures[2], rect });
-            } else if (tile == '+')
-            {
-                gameObjects.push_back({ textures[3], rect });
-                ++totalCoins;
-            } else if (tile == '^') {
-                gameObjects.push_back({textures[8], rect});
-                //++totalLives;
-            } else if (tile == '@') {
-                if (playerInit) {
-                    throw runtime_error("Error: Player character initialized more than once!");
-                }
-                player = { playerTextures[1], rect };
-                playerInit = true;
-            } else if (tile == '$') {
-                enemyPositions.push_back(x);
-            } else if (tile == 'D') {
-                if (doorInit) {
-                    throw runtime_error("Error: More than one door initialized!");
-                }
-                rect.h = TILE_SIZE * 2;
-                rect.y -= TILE_SIZE;
-                door = { textures[6], rect };
-                doorInit = true;
-            }
-        }
-
-        // Create enemies and their movement paths
-        for (size_t i = 0; i < enemyPositions.size(); i += 2) {
-            if (i + 1 < enemyPositions.size()) {
-                float startX = enemyPositions[i] * TILE_SIZE;
-                float endX = enemyPositions[i + 1] * TILE_SIZE;
-                float enemySize = TILE_SIZE * 0.75; // 25% smaller than TILE_SIZE
-                float yOffset = TILE_SIZE - enemySize; // Calculate the offset to align to the bottom
-                SDL_FRect enemyRect = { startX, y * TILE_SIZE + yOffset, enemySize, enemySize };
-                GameObject enemy = { textures[4], enemyRect };
-                SDL_FRect path = { startX, y * TILE_SIZE, endX - startX, TILE_SIZE };
-                enemies.push_back({ enemy, path, 0.05f, true, textures[4], textures[5], true });
-            }
-        }
-        ++y;
-    }
-}
-
-bool hasIntersection(const SDL_FRect& A, const SDL_FRect& B) {
-    if (A.x + A.w <= B.x || B.x + B.w <= A.x || A.y + A.h <= B.y || B.y + B.h <= A.y) {
-        return false;
-    }
-
-    return true;
-}
-
-bool isOnVine(const GameObject& player, const vector<GameObject>& gameObjects, const SDL_Texture* vineTexture) {
-    for (const auto& obj : gameObjects) {
-        if (obj.texture == vineTexture) {
-            return false;
-        }
-        if (obj.texture == vineTexture && hasIntersection(player.rect, obj.rect)) {
-            return true;
-        }
-    }
-    return false;
-}
-
-bool isOnPlatform(const GameObject& player, const vector<GameObject>& gameObjects, const SDL_Texture* brickTexture) {
-    SDL_FRect belowPlayer = player.rect;
-    belowPlayer.y += 1; // Check just below the player
-    for (const auto& obj : gameObjects) { //NOLINT(readability-use-anyofallof)
-        if (obj.texture == brickTexture && hasIntersection(belowPlayer, obj.rect)) {
-            return true;
-        }
-    }
-    return false;
-}
-
 bool isPointInRect(int x, int y, const SDL_Rect& rect) {
     return x >= rect.x && x <= rect.x + rect.w && y >= rect.y && y <= rect.y + rect.h;
 }
@@ -188,34 +77,28 @@ float calcOffset(float n) {
     return (n * 30 - n * 5 / 3) / 4;
 }
 
-void renderText(SDL_Renderer* renderer, const string& text, float x, float y, SDL_Color textColor = { 255, 255, 255, 255 }) {
-    SDL_Surface* textSurface = TTF_RenderUTF8_Solid(font, text.c_str(), textColor);
-    SDL_Texture* textTexture = SDL_CreateTextureFromSurface(renderer, textSurface);
-    const float tsw = textSurface -> w;
-    const float tsh = textSurface -> h;
-    const SDL_FRect textRect = { x, y, tsw, tsh };
-    SDL_RenderCopyF(renderer, textTexture, nullptr, &textRect);
-    SDL_FreeSurface(textSurface);
-    SDL_DestroyTexture(textTexture);
+void renderText(SDL_Renderer* renderer, string_view text, float x, float y, SDL_Color textColor = { 255, 255, 255, 255 }) {
+    textAtlas.draw(renderer, text, x, y, textColor);
+}
+
+void present(SDL_Renderer* renderer) {
+    PROFILE_ZONE("present");
+    SDL_RenderPresent(renderer);
 }
 
 //NOLINTBEGIN(bugprone-integer-division)
 int padding = 10;
 
 SDL_FRect buttonRect(const Button& button) {
-    int textWidth, textHeight;
-    TTF_SizeText(font, button.text.c_str(), &textWidth, &textHeight);
+    int textWidth = textAtlas.textWidth(button.text);
+    int textHeight = textAtlas.lineHeight();
 
     SDL_FRect rect = { button.x - padding, button.y - padding / 2, static_cast<float>(textWidth + padding * 2), static_cast<float>(textHeight + padding) };
     return rect;
 }
 
 void renderButton(SDL_Renderer* renderer, const Button& button, SDL_Color color) {
-    int textWidth, textHeight;
-    TTF_SizeText(font, button.text.c_str(), &textWidth, &textHeight);
-
-    // Add padding to the text size to determine the button size
-    SDL_FRect rect = { button.x - padding, button.y - padding / 2, static_cast<float>(textWidth + padding * 2), static_cast<float>(textHeight + padding) };
+    SDL_FRect rect = buttonRect(button);
 
     SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, color.a);
     SDL_RenderFillRectF(renderer, &rect);
@@ -238,12 +121,17 @@ bool isButtonClicked(const SDL_FRect& rect, const int mouseX, const int mouseY)
 Button normalModeButton = { "Normal Mode", SCREEN_WIDTH / 2 - calcOffset(12), SCREEN_HEIGHT / 2 - 16 };
 Button levelSelectButton = { "Level Select", SCREEN_WIDTH / 2 - calcOffset(13), SCREEN_HEIGHT / 2 + 32 };
 
-void renderModeSelectScreen(SDL_Renderer* renderer, SDL_Texture* backgroundTexture) {
+// Each menu screen is drawn in two parts: its backdrop, everything that does not follow the
+// mouse, which main keeps in a MenuLayer, and the buttons on top of that
+
+void renderModeSelectBackdrop(SDL_Renderer* renderer, SDL_Texture* backgroundTexture) {
     SDL_RenderClear(renderer);
     renderBackgroundWithFadeOut(renderer, backgroundTexture);
 
     renderText(renderer, "Select Mode", SCREEN_WIDTH / 2 - calcOffset(11), SCREEN_HEIGHT / 2 - 64 );
+}
 
+void renderModeSelectScreen(SDL_Renderer* renderer) {
     int mouseX, mouseY;
     SDL_GetMouseState(&mouseX, &mouseY);
 
@@ -257,19 +145,19 @@ void renderModeSelectScreen(SDL_Renderer* renderer, SDL_Texture* backgroundTextu
     if (isPointInRectF(mouseX, mouseY, buttonRect(levelSelectButton)))
         renderButton(renderer, levelSelectButton, buttonHoverColor);
     renderButton(renderer, levelSelectButton, buttonColor);
-
-    SDL_RenderPresent(renderer);
 }
 
 Button playButton = {"Play", SCREEN_WIDTH / 2 - calcOffset(4), SCREEN_HEIGHT / 2 - 16};
 Button settingsButton = { "Settings", SCREEN_WIDTH / 2 - calcOffset(8), SCREEN_HEIGHT / 2 + 32 };
 
-void renderStartScreen(SDL_Renderer* renderer, SDL_Texture* backgroundTexture) {
+void renderStartBackdrop(SDL_Renderer* renderer, SDL_Texture* backgroundTexture) {
     SDL_RenderClear(renderer);
     renderBackgroundWithFadeOut(renderer, backgroundTexture);
 
     renderText(renderer, "Super Mario", SCREEN_WIDTH / 2 - calcOffset(11), SCREEN_HEIGHT / 2 - 64 );
+}
 
+void renderStartScreen(SDL_Renderer* renderer) {
     int mouseX, mouseY;
     SDL_GetMouseState(&mouseX, &mouseY);
 
@@ -283,8 +171,6 @@ void renderStartScreen(SDL_Renderer* renderer, SDL_Texture* backgroundTexture) {
     if (isPointInRectF(mouseX, mouseY, buttonRect(settingsButton)))
         renderButton(renderer, settingsButton, buttonHoverColor);
     renderButton(renderer, settingsButton, buttonColor);
-
-    SDL_RenderPresent(renderer);
 }
 
 SDL_FRect marioRect = { SCREEN_WIDTH / 2 - 100, SCREEN_HEIGHT / 2 - 100, 50, 50 };
@@ -294,30 +180,15 @@ Button aboutButton = { "About", SCREEN_WIDTH / 2 - calcOffset(5), SCREEN_HEIGHT
 
 vector SettingsButtons = { aboutButton };
 
-void renderSettingsScreen(SDL_Renderer* renderer, SDL_Texture* backgroundTexture) {
+void renderSettingsBackdrop(SDL_Renderer* renderer, SDL_Texture* backgroundTexture, Character playerChar, const Sprite& marioSprite, const Sprite& luigiSprite) {
     SDL_RenderClear(renderer);
     renderBackgroundWithFadeOut(renderer, backgroundTexture);
 
-    int mouseX, mouseY;
-    SDL_GetMouseState(&mouseX, &mouseY);
-
-    SDL_Color buttonColor = { 255, 255, 255, 128 };
-    SDL_Color buttonHoverColor = { 0, 255, 0, 128 };
-
     renderText(renderer, "Change Character", SCREEN_WIDTH / 2 - calcOffset(16), SCREEN_HEIGHT / 2 - 150);
 
-    if (isPointInRectF(mouseX, mouseY, buttonRect(aboutButton))) {
-        renderButton(renderer, aboutButton, buttonHoverColor);
-    } else {
-        renderButton(renderer, aboutButton, buttonColor);
-    }
-
     // Draw the two characters
-    SDL_Texture* marioTexture = IMG_LoadTexture(renderer, "../resources/player/mario/left.png");
-    SDL_Texture* luigiTexture = IMG_LoadTexture(renderer, "../resources/player/luigi/left.png");
-
-    SDL_RenderCopyF(renderer, marioTexture, nullptr, &marioRect);
-    SDL_RenderCopyF(renderer, luigiTexture, nullptr, &luigiRect);
+    renderSprite(renderer, marioSprite, marioRect);
+    renderSprite(renderer, luigiSprite, luigiRect);
 
     // Draw a thick square border around the selected character
     Character selectedCharacter = (playerChar == mario) ? mario : luigi;
@@ -335,14 +206,24 @@ void renderSettingsScreen(SDL_Renderer* renderer, SDL_Texture* backgroundTexture
         selectedRect.w += 4;
         selectedRect.h += 4;
     }
+}
 
-    SDL_DestroyTexture(marioTexture);
-    SDL_DestroyTexture(luigiTexture);
+void renderSettingsScreen(SDL_Renderer* renderer) {
+    int mouseX, mouseY;
+    SDL_GetMouseState(&mouseX, &mouseY);
 
-    SDL_RenderPresent(renderer);
+    SDL_Color buttonColor = { 255, 255, 255, 128 };
+    SDL_Color buttonHoverColor = { 0, 255, 0, 128 };
+
+    if (isPointInRectF(mouseX, mouseY, buttonRect(aboutButton))) {
+        renderButton(renderer, aboutButton, buttonHoverColor);
+    } else {
+        renderButton(renderer, aboutButton, buttonColor);
+    }
 }
 
-void renderAboutScreen(SDL_Renderer* renderer, SDL_Texture* backgroundTexture) {
+// Nothing on it follows the mouse, the backdrop is the whole screen
+void renderAboutBackdrop(SDL_Renderer* renderer, SDL_Texture* backgroundTexture) {
     SDL_RenderClear(renderer);
     renderBackgroundWithFadeOut(renderer, backgroundTexture, 128);
 
@@ -350,36 +231,32 @@ void renderAboutScreen(SDL_Renderer* renderer, SDL_Texture* backgroundTexture) {
     renderText(renderer, "Code licensed under GNU GPL 3.0", SCREEN_WIDTH / 2 - calcOffset(31), SCREEN_HEIGHT / 2);
     renderText(renderer, "Assets (excluding /resources/font) © Nintendo Co., Ltd.", SCREEN_WIDTH / 2 - calcOffset(55), SCREEN_HEIGHT / 2 + 32);
     renderText(renderer, "Font licensed under the SIL OFL 1.1", SCREEN_WIDTH / 2 - calcOffset(35), SCREEN_HEIGHT / 2 + 64);
-
-    SDL_RenderPresent(renderer);
 }
 
-vector<string> getLevelFiles(const string& folderPath) {
-    vector<string> levelFiles;
+SDL_Rect leftArrowRect = { SCREEN_WIDTH / 2 - 150, 250, 50, 50 };
+SDL_Rect rightArrowRect = { SCREEN_WIDTH / 2 + 100, 250, 50, 50 };
 
-    for (const auto& entry : directory_iterator(folderPath)) {
-        if (entry.path().extension() == ".lvl") {
-            levelFiles.push_back(entry.path().string());
-        }
-    }
+static int levelScrollOffset = 0;
 
-    // Manual bubble sort
-    for (size_t i = 0; i < levelFiles.size(); ++i) {
-        for (size_t j = 0; j < levelFiles.size() - i - 1; ++j) {
-            if (levelFiles[j] > levelFiles[j + 1]) {
-                swap(levelFiles[j], levelFiles[j + 1]);
-            }
-        }
-    }
-    return levelFiles;
+// The levels listed at once, with arrows to scroll through the rest when there are more
+constexpr int visibleLevels = 5;
+
+int firstListedLevel(const vector<string>& levelFiles) {
+    return levelFiles.size() > visibleLevels ? levelScrollOffset : 0;
 }
 
-SDL_Rect leftArrowRect = { SCREEN_WIDTH / 2 - 150, 250, 50, 50 };
-SDL_Rect rightArrowRect = { SCREEN_WIDTH / 2 + 100, 250, 50, 50 };
+string levelDisplayName(const string& levelFile) {
+    return levelFile.substr(levelFile.find_last_of("/\\") + 1);
+}
 
-static int levelScrollOffset = 0;
+// The outline around the row-th listed level, its name is drawn at the outline's corner inset by 5
+SDL_Rect levelSelectRect(const string& levelName, int row) {
+    int x = SCREEN_WIDTH / 2 - calcOffset(levelName.length());
+    int y = 200 + row * 30;
+    return { x - 5, y + row * 5, static_cast<int>(levelName.length() * 15), 30 };
+}
 
-void renderLevelSelectScreen(SDL_Renderer* renderer, const vector<string>& levelFiles, vector<SDL_Rect>& levelRects, SDL_Texture* backgroundTexture) {
+void renderLevelSelectBackdrop(SDL_Renderer* renderer, const vector<string>& levelFiles, SDL_Texture* backgroundTexture) {
     SDL_RenderCopyF(renderer, backgroundTexture, nullptr, nullptr);
     SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
     SDL_SetRenderDrawColor(renderer, 0, 0, 0, 96);
@@ -387,828 +264,953 @@ void renderLevelSelectScreen(SDL_Renderer* renderer, const vector<string>& level
 
     renderText(renderer, "Select a Level", SCREEN_WIDTH / 2 - 100, 150);
 
-    levelRects.clear();
-    SDL_Color outlineColor = { 255, 255, 255, 255 }; // White color for the outline
-    SDL_Color hoverColor = { 255, 0, 0, 255 }; // Red color for hover effect
-
-    int mouseX, mouseY;
-    SDL_GetMouseState(&mouseX, &mouseY);
-    Sint32 numberOfLevels = levelFiles.size();
-
     // If there are more than 5 levels, draw arrows and only show a subset
-    if (levelFiles.size() > 5) {
+    if (levelFiles.size() > visibleLevels) {
         SDL_SetRenderDrawColor(renderer, 0, 0, 0, 51);
         SDL_RenderFillRect(renderer, &leftArrowRect);
         SDL_RenderFillRect(renderer, &rightArrowRect);
 
         renderText(renderer, "<", leftArrowRect.x + 17, leftArrowRect.y + 10);
         renderText(renderer, ">", rightArrowRect.x + 17, rightArrowRect.y + 10);
+    }
 
-        // Only display levels from levelScrollOffset to levelScrollOffset + 5
-        for (int i = levelScrollOffset; i < min(levelScrollOffset + 5, numberOfLevels); ++i) {
-            string levelName = levelFiles[i].substr(levelFiles[i].find_last_of("/\\") + 1);
+    Sint32 numberOfLevels = levelFiles.size();
+    int first = firstListedLevel(levelFiles);
+    for (int i = first; i < min(first + visibleLevels, numberOfLevels); ++i) {
+        string levelName = levelDisplayName(levelFiles[i]);
+        SDL_Rect rect = levelSelectRect(levelName, i - first);
+        renderText(renderer, levelName, rect.x + 5, rect.y);
+    }
+}
 
-            int x = SCREEN_WIDTH / 2 - calcOffset(levelName.length());
-            int y = 200 + (i - levelScrollOffset) * 30;
-            renderText(renderer, levelName, x, y + ((i - levelScrollOffset) * 5));
+void renderLevelSelectScreen(SDL_Renderer* renderer, const vector<string>& levelFiles, vector<SDL_Rect>& levelRects) {
+    levelRects.clear();
+    SDL_Color outlineColor = { 255, 255, 255, 255 }; // White color for the outline
+    SDL_Color hoverColor = { 255, 0, 0, 255 }; // Red color for hover effect
 
-            SDL_Rect rect = { x - 5 , y + ((i - levelScrollOffset) * 5), static_cast<int>(levelName.length() * 15), 30 };
-            levelRects.push_back(rect);
+    int mouseX, mouseY;
+    SDL_GetMouseState(&mouseX, &mouseY);
+    Sint32 numberOfLevels = levelFiles.size();
 
-            if (isPointInRect(mouseX, mouseY, rect)) {
-                drawRectOutline(renderer, rect, hoverColor);
-            } else {
-                drawRectOutline(renderer, rect, outlineColor);
-            }
+    int first = firstListedLevel(levelFiles);
+    for (int i = first; i < min(first + visibleLevels, numberOfLevels); ++i) {
+        SDL_Rect rect = levelSelectRect(levelDisplayName(levelFiles[i]), i - first);
+        levelRects.push_back(rect);
+
+        if (isPointInRect(mouseX, mouseY, rect)) {
+            drawRectOutline(renderer, rect, hoverColor);
+        } else {
+            drawRectOutline(renderer, rect, outlineColor);
         }
-    } else {
-        // Display all levels because there are 5 or fewer
-        for (int i = 0; i < levelFiles.size(); ++i) {
-            string levelName = levelFiles[i].substr(levelFiles[i].find_last_of("/\\") + 1);
+    }
+}
 
-            int x = SCREEN_WIDTH / 2 - calcOffset(levelName.length());
-            int y = 200 + i * 30;
-            renderText(renderer, levelName, x, y + ( i * 5));
+// Draws obj where the camera sees it, objects out of view are not submitted at all
+void renderGameObject(SDL_Renderer* renderer, const GameObject& obj, const SDL_FRect& camera) {
+    if (!hasIntersection(obj.rect, camera)) {
+        return;
+    }
+    SDL_FRect screenRect = { obj.rect.x - camera.x, obj.rect.y - camera.y, obj.rect.w, obj.rect.h };
+    spriteBatch.draw(renderer, *obj.sprite, screenRect);
+}
 
-            SDL_Rect rect = { x - 5 , y + ( i * 5), static_cast<int>(levelName.length() * 15), 30 };
-            levelRects.push_back(rect);
+// The rect alpha of the way from previous to current. Jumps of more than two tiles are
+// respawns or level changes, those snap instead of sliding across the screen.
+SDL_FRect interpolate(const SDL_FRect& previous, const SDL_FRect& current, float alpha) {
+    if (fabs(current.x - previous.x) > TILE_SIZE * 2 || fabs(current.y - previous.y) > TILE_SIZE * 2) {
+        return current;
+    }
+    return { previous.x + (current.x - previous.x) * alpha, previous.y + (current.y - previous.y) * alpha, current.w, current.h };
+}
 
-            if (isPointInRect(mouseX, mouseY, rect)) {
-                drawRectOutline(renderer, rect, hoverColor);
-            } else {
-                drawRectOutline(renderer, rect, outlineColor);
+// skipStatic leaves out the bricks and vines, for when the static layer already drew them
+void renderLevelObjects(SDL_Renderer* renderer, const Level& level, const SDL_FRect& camera, bool skipStatic) {
+    for (const Chunk* chunk : level.residentChunks) {
+        if (!hasIntersection(chunkRect(*chunk), camera)) {
+            continue;
+        }
+        for (const auto& obj : chunk->gameObjects) {
+            if (!skipStatic || !level.isStatic(obj)) {
+                renderGameObject(renderer, obj, camera);
             }
         }
     }
-
-    SDL_RenderPresent(renderer);
 }
 
-float enemySpeed = 0.05f;
-
-void updateEnemies(vector<Enemy>& enemies, const GameObject& player, Mix_Chunk* killSound) {
-    for (auto& enemy : enemies) {
-        float previousX = enemy.gameObject.rect.x;
-
-        if (enemy.movingRight) {
-            enemy.gameObject.rect.x += enemySpeed;
-            if (enemy.gameObject.rect.x >= enemy.path.x + enemy.path.w) {
-                enemy.movingRight = false;
-            }
-        } else {
-            enemy.gameObject.rect.x -= enemySpeed;
-            if (enemy.gameObject.rect.x <= enemy.path.x) {
-                enemy.movingRight = true;
+// Draws the background, the level around the player, the player and optionally the door and the
+// enemies. Moving objects are drawn alpha of the way from their previous tick to their current one.
+void renderWorld(SDL_Renderer* renderer, const GameSession& session, float alpha, bool drawDoor, bool drawEnemies) {
+    PROFILE_ZONE("render world");
+    const Level& level = session.level;
+    GameObject drawnPlayer = { level.player.sprite, interpolate(session.previousPlayerRect, level.player.rect, alpha), OBJECT_PLAYER };
+    SDL_FRect camera = cameraView(level, drawnPlayer);
+
+    SDL_RenderCopyF(renderer, session.background, nullptr, nullptr);
+    renderStats.draw(session.background);
+    // Falls back to drawing every tile when the renderer can't draw into textures
+    bool staticDrawn = staticLayers.render(renderer, level, camera);
+    renderLevelObjects(renderer, level, camera, staticDrawn);
+    if (drawDoor) {
+        renderGameObject(renderer, level.door, camera);
+    }
+    renderGameObject(renderer, drawnPlayer, camera);
+
+    if (drawEnemies) {
+        // One batch test finds the enemies near the camera, a tile of margin covers the tick they are drawn behind
+        const EnemySet& enemies = level.enemies;
+        static vector<uint64_t> nearCamera;
+        nearCamera.resize((enemies.size() + 63) / 64);
+        SDL_FRect margin = { camera.x - TILE_SIZE, camera.y - TILE_SIZE, camera.w + TILE_SIZE * 2, camera.h + TILE_SIZE * 2 };
+        intersectionMask(margin, enemies.rects(), nearCamera.data());
+        for (size_t word = 0; word < nearCamera.size(); ++word) {
+            for (uint64_t bits = nearCamera[word]; bits; bits &= bits - 1) {
+                size_t i = word * 64 + countr_zero(bits);
+                GameObject drawnEnemy = { enemies.sprite(i), interpolate(enemies.previousRect(i), enemies.rect(i), alpha), OBJECT_ENEMY };
+                renderGameObject(renderer, drawnEnemy, camera);
             }
         }
+    }
+    spriteBatch.flush(renderer);
+}
 
-        if (previousX / TILE_SIZE != enemy.gameObject.rect.x / TILE_SIZE) {
-            enemy.useLeftTexture = !enemy.useLeftTexture;
-            enemy.gameObject.texture = enemy.useLeftTexture ? enemy.textureLeft : enemy.textureRight;
+void renderFade(SDL_Renderer* renderer, float progress) {
+    Uint8 alpha = progress * 255;
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, alpha);
+    SDL_RenderFillRect(renderer, nullptr);
+    renderStats.draw(nullptr);
+}
+
+// The HUD's lines, formatted into fixed buffers only when the values behind them change, so
+// drawing the HUD allocates nothing
+struct HudText {
+    Sint32 seconds = -1;
+    int coins = -1;
+    int totalCoins = -1;
+    int level = -1;
+    char time[32] = "";
+    char coinCount[48] = "";
+    char levelNumber[32] = "";
+
+    void update(const GameSession& session) {
+        if (session.remainingSeconds() != seconds) {
+            seconds = session.remainingSeconds();
+            snprintf(time, sizeof(time), "Time: %d", static_cast<int>(seconds));
         }
+        if (session.collectedCoins != coins || session.totalCoins != totalCoins) {
+            coins = session.collectedCoins;
+            totalCoins = session.totalCoins;
+            snprintf(coinCount, sizeof(coinCount), "Coins: %d/%d", coins, totalCoins);
+        }
+        if (session.currentLevelIndex + 1 != level) {
+            level = session.currentLevelIndex + 1;
+            snprintf(levelNumber, sizeof(levelNumber), "Level: %d", level);
+        }
+    }
+};
+
+HudText hudText;
+
+// The time, coins, level and lives drawn over the world while playing
+void renderHud(SDL_Renderer* renderer, const GameSession& session, const Sprite& lifeSprite) {
+    PROFILE_ZONE("render hud");
+    hudText.update(session);
+    renderText(renderer, hudText.time, SCREEN_WIDTH / 2 - calcOffset(strlen(hudText.time)), SCREEN_HEIGHT - 32); // NOLINT(*-integer-division)
+    renderText(renderer, hudText.coinCount, 10, SCREEN_HEIGHT - 32);
+    renderText(renderer, hudText.levelNumber, SCREEN_WIDTH - 124, SCREEN_HEIGHT - 32);
 
-        // Check if the player intersects with the top of the enemy
-        SDL_FRect playerBottom = player.rect;
-        playerBottom.y += player.rect.h;
-        playerBottom.h = 1;
+    for (int i = 0; i < session.lives; ++i) {
+        SDL_FRect lifeRect = { static_cast<float>(SCREEN_WIDTH - (i + 1) * (TILE_SIZE + 5)), 10, TILE_SIZE, TILE_SIZE };
+        spriteBatch.draw(renderer, lifeSprite, lifeRect);
+    }
+    spriteBatch.flush(renderer);
+}
 
-        SDL_FRect enemyTop = enemy.gameObject.rect;
-        enemyTop.h = 1;
+// F4 overlay with what each profiled zone cost per frame, and the length of the last frames as a
+// graph under it, a line at 60 fps
+void renderProfilerOverlay(SDL_Renderer* renderer) {
+    constexpr float graphHeight = 60;
+    constexpr float msPerPixel = 1000.0f / 30 / graphHeight; // a 30 fps frame fills the graph
+    constexpr float barWidth = 2;
+    float graphBottom = SCREEN_HEIGHT - 40;
+    float y = 60;
+    for (const Profiler::ZoneTime& zone : profiler.zones()) {
+        char line[64];
+        snprintf(line, sizeof(line), "%-20s %6.3f ms", zone.name, zone.ms);
+        renderText(renderer, line, SCREEN_WIDTH - 360, y);
+        y += textAtlas.lineHeight();
+    }
+
+    static array<SDL_FRect, Profiler::frameHistory> bars;
+    for (size_t i = 0; i < bars.size(); ++i) {
+        float height = min(profiler.frameMs(i) / msPerPixel, graphHeight);
+        bars[i] = { 10 + i * barWidth, graphBottom - height, barWidth, height };
+    }
+    SDL_FRect panel = { 10, graphBottom - graphHeight, bars.size() * barWidth, graphHeight };
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 128);
+    SDL_RenderFillRectF(renderer, &panel);
+    renderStats.draw(nullptr);
+    SDL_SetRenderDrawColor(renderer, 0, 255, 0, 255);
+    SDL_RenderFillRectsF(renderer, bars.data(), static_cast<int>(bars.size()));
+    renderStats.draw(nullptr);
+    float targetY = graphBottom - 1000.0f / 60 / msPerPixel;
+    SDL_SetRenderDrawColor(renderer, 255, 0, 0, 255);
+    SDL_RenderDrawLineF(renderer, panel.x, targetY, panel.x + panel.w, targetY);
+    renderStats.draw(nullptr);
+}
+
+// F3 overlay with what the frame before this one cost. Formatted on the stack, so turning it on
+// does not make the frame allocate.
+void renderStatsOverlay(SDL_Renderer* renderer, const RenderStats& lastFrame, const AssetCache::Stats& assets, const BackgroundCache& backgrounds, const FramePacer& pacer,
+                        uint64_t lastFrameAllocations) {
+    char line[192];
+    float y = 10;
+    auto print = [&] {
+        renderText(renderer, line, 10, y);
+        y += textAtlas.lineHeight();
+    };
+    snprintf(line, sizeof(line), "Draw calls: %d  Texture switches: %d  Static chunks: %zu", lastFrame.drawCalls, lastFrame.textureSwitches, staticLayers.textureCount());
+    print();
+    snprintf(line, sizeof(line), "Textures: %zu (%zu KiB)  Hits: %llu  Misses: %llu", assets.residentTextures, assets.residentBytes / 1024,
+             static_cast<unsigned long long>(assets.hits), static_cast<unsigned long long>(assets.misses));
+    print();
+    const BackgroundCache::Stats& residency = backgrounds.stats();
+    snprintf(line, sizeof(line), "Backgrounds: %zu/%zu (%zu of %zu KiB)  Loads: %llu  Evictions: %llu", residency.residentTextures, backgrounds.count(),
+             residency.residentBytes / 1024, backgrounds.budgetBytes() / 1024, static_cast<unsigned long long>(residency.loads),
+             static_cast<unsigned long long>(residency.evictions));
+    print();
+    const FramePacer::Stats& frames = pacer.lastSecond();
+    char pacing[32];
+    if (pacer.mode() == PACING_CAP) {
+        snprintf(pacing, sizeof(pacing), "cap %d fps", pacer.fps());
+    } else {
+        snprintf(pacing, sizeof(pacing), "%s", pacingModeName(pacer.mode()));
+    }
+    snprintf(line, sizeof(line), "Frame: %.2f ms mean, %.1f p99, %.1f max  CPU: %.0f%%  (%s)", frames.times.meanMs, frames.times.p99Ms, frames.times.maxMs,
+             frames.cpuPercent, pacing);
+    print();
+    if (countingAllocations) {
+        snprintf(line, sizeof(line), "Allocations: %llu last frame", static_cast<unsigned long long>(lastFrameAllocations));
+        print();
+    }
+}
 
-        if (hasIntersection(playerBottom, enemyTop)) {
-            Mix_PlayChannel(-1, killSound, 0); // Play the kill sound
-            erase_if(enemies, [&enemy](const Enemy& o) {
-                return &o == &enemy;
-            });
+// Plays the sounds and music changes the session asked for since the last frame
+void playAudioCues(GameSession& session, const vector<Mix_Chunk*>& sounds) {
+    for (AudioCue cue : session.audio) {
+        switch (cue) {
+        case CUE_PAUSE_MUSIC:
+            Mix_PauseMusic();
+            break;
+        case CUE_RESUME_MUSIC:
+            Mix_ResumeMusic();
+            break;
+        case CUE_HALT_MUSIC:
+            Mix_HaltMusic();
+            break;
+        case CUE_HALT_SOUNDS:
+            Mix_HaltGroup(-1);
+            break;
+        case CUE_COIN:
+            Mix_PlayChannel(0, sounds[cue], 0); // Play the coin sound on any available channel
+            break;
+        default:
+            Mix_PlayChannel(-1, sounds[cue], 0);
             break;
         }
     }
+    session.audio.clear();
 }
 
 SDL_FRect nextLevelButton = { SCREEN_WIDTH / 2 - calcOffset(10) - 5, SCREEN_HEIGHT / 2 + 32, 150, 32 };
 
-void renderWinningScreen(SDL_Renderer* renderer, bool isLastLevel) {
-    SDL_Color outlineColor = { 255, 255, 255, 255 }; // White color for the outline
-    SDL_Color hoverColor = { 0, 255, 0, 255 }; // Green color for hover effect
-
+void renderWinningBackdrop(SDL_Renderer* renderer, bool isLastLevel) {
     SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
     SDL_RenderClear(renderer);
 
-    int mouseX, mouseY;
-    SDL_GetMouseState(&mouseX, &mouseY);
-
     if (isLastLevel) {
         renderText(renderer, "You have completed the game!", SCREEN_WIDTH / 2 - calcOffset(28), SCREEN_HEIGHT / 2 - 32);
         renderText(renderer, "Press Space to exit", SCREEN_WIDTH / 2 - calcOffset(19), SCREEN_HEIGHT / 2 + 32);
     } else {
         renderText(renderer, "You won!", SCREEN_WIDTH / 2 - calcOffset(8), SCREEN_HEIGHT / 2 - 32);
         renderText(renderer, "Next Level", SCREEN_WIDTH / 2 - calcOffset(10), SCREEN_HEIGHT / 2 + 32);
+    }
+}
+
+void renderWinningScreen(SDL_Renderer* renderer, bool isLastLevel) {
+    SDL_Color outlineColor = { 255, 255, 255, 255 }; // White color for the outline
+    SDL_Color hoverColor = { 0, 255, 0, 255 }; // Green color for hover effect
+
+    int mouseX, mouseY;
+    SDL_GetMouseState(&mouseX, &mouseY);
+
+    if (!isLastLevel) {
         if (isPointInRectF(mouseX, mouseY, nextLevelButton)) {
             drawRectOutlineF(renderer, nextLevelButton, hoverColor);
         } else {
             drawRectOutlineF(renderer, nextLevelButton, outlineColor);
         }
     }
-
-    SDL_RenderPresent(renderer);
 }
 
 Button retryLevelButton = { "Retry level", SCREEN_WIDTH / 2 - calcOffset(11), SCREEN_HEIGHT / 2 };
 Button tryAgainButton = { "Try again", SCREEN_WIDTH / 2 - calcOffset(9), SCREEN_HEIGHT / 2 + 32 };
 
-void renderLostScreen(SDL_Renderer* renderer, const string& reason) {
-    SDL_Color hoverColor = { 0, 255, 0, 255 };
+// The button the lost screen offers, depending on how the player lost
+const Button& lostScreenButton(DeathReason reason) {
+    return reason == DEATH_LIVES ? tryAgainButton : retryLevelButton;
+}
 
+void renderLostBackdrop(SDL_Renderer* renderer, DeathReason reason) {
     SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
     SDL_RenderClear(renderer);
-    if (reason == "time") {
+    if (reason == DEATH_TIME) {
         renderText(renderer, "Time's up!", SCREEN_WIDTH / 2 - calcOffset(10), SCREEN_HEIGHT / 2 - 64);
-    } else if (reason == "lives") {
+    } else if (reason == DEATH_LIVES) {
         renderText(renderer, "You ran out of lives!", SCREEN_WIDTH / 2 - calcOffset(21), SCREEN_HEIGHT / 2 - 64);
     } else {
         renderText(renderer, "You Lost!", SCREEN_WIDTH / 2 - calcOffset(9), SCREEN_HEIGHT / 2 - 64);
     }
     //renderText(renderer, "Press Space to exit", SCREEN_WIDTH / 2 - calcOffset(19), SCREEN_HEIGHT / 2 + 64);
 
+    renderButton(renderer, lostScreenButton(reason), { 255, 255, 255, 128 });
+}
+
+void renderLostScreen(SDL_Renderer* renderer, DeathReason reason) {
+    SDL_Color hoverColor = { 0, 255, 0, 255 };
+
     int mouseX, mouseY;
     SDL_GetMouseState(&mouseX, &mouseY);
 
-    if (reason == "lives")
-    {
-        renderButton(renderer, tryAgainButton, { 255, 255, 255, 128 });
-        if (isPointInRectF(mouseX, mouseY, buttonRect(tryAgainButton))) {
-            drawRectOutlineF(renderer, buttonRect(tryAgainButton), hoverColor);
-        }
-    } else {
-        renderButton(renderer, retryLevelButton, { 255, 255, 255, 128 });
-        if (isPointInRectF(mouseX, mouseY, buttonRect(retryLevelButton))) {
-            drawRectOutlineF(renderer, buttonRect(retryLevelButton), hoverColor);
+    SDL_FRect button = buttonRect(lostScreenButton(reason));
+    if (isPointInRectF(mouseX, mouseY, button)) {
+        drawRectOutlineF(renderer, button, hoverColor);
+    }
+}
+
+// Which of the current screen's buttons the mouse is over, -1 for none. The menus are only
+// redrawn when this changes, or on a click, a key press or an expose.
+int hoveredButton(const GameSession& session, int mouseX, int mouseY) {
+    auto over = [&](const Button& button) { return isPointInRectF(mouseX, mouseY, buttonRect(button)); };
+    switch (session.state) {
+    case START_SCREEN:
+        return over(playButton) ? 0 : over(settingsButton) ? 1 : -1;
+    case MODE_SELECT:
+        return over(normalModeButton) ? 0 : over(levelSelectButton) ? 1 : -1;
+    case SETTINGS:
+        return over(aboutButton) ? 0 : -1;
+    case LEVEL_SELECT: {
+        int first = firstListedLevel(session.levelFiles);
+        for (int i = first; i < min(first + visibleLevels, static_cast<int>(session.levelFiles.size())); ++i) {
+            if (isPointInRect(mouseX, mouseY, levelSelectRect(levelDisplayName(session.levelFiles[i]), i - first))) {
+                return i;
+            }
         }
+        return -1;
+    }
+    case WON:
+        return !session.isLastLevel && isPointInRectF(mouseX, mouseY, nextLevelButton) ? 0 : -1;
+    case LOST:
+        return over(lostScreenButton(session.deathReason)) ? 0 : -1;
+    default:
+        return -1;
     }
-    SDL_RenderPresent(renderer);
+}
+
+// The longest an idle menu sleeps in SDL_WaitEventTimeout without any event
+constexpr int menuWakeMs = 500;
+
+// What a menu's backdrop depends on, the backdrop is drawn again whenever this changes
+struct MenuView {
+    GameState state = START_SCREEN;
+    SDL_Texture* background = nullptr;
+    int variant = 0; // the selected character, the scroll position or how the level ended
+
+    bool operator==(const MenuView&) const = default;
+};
+
+MenuView menuView(const GameSession& session) {
+    MenuView view = { session.state, session.background };
+    if (session.state == SETTINGS) {
+        view.variant = session.playerChar;
+    } else if (session.state == LEVEL_SELECT) {
+        view.variant = levelScrollOffset;
+    } else if (session.state == WON) {
+        view.variant = session.isLastLevel;
+    } else if (session.state == LOST) {
+        view.variant = session.deathReason == DEATH_TIME ? 0 : session.deathReason == DEATH_LIVES ? 1 : 2;
+    }
+    return view;
+}
+
+// Draws the menu screen the session is on, its backdrop through layer
+void renderMenu(SDL_Renderer* renderer, const GameSession& session, MenuLayer& layer, const Sprite& marioSprite, const Sprite& luigiSprite, vector<SDL_Rect>& levelRects) {
+    PROFILE_ZONE("render menu");
+    SDL_Texture* background = session.background;
+    switch (session.state) {
+    case START_SCREEN:
+        layer.render(renderer, [&] { renderStartBackdrop(renderer, background); });
+        renderStartScreen(renderer);
+        break;
+    case MODE_SELECT:
+        layer.render(renderer, [&] { renderModeSelectBackdrop(renderer, background); });
+        renderModeSelectScreen(renderer);
+        break;
+    case SETTINGS:
+        layer.render(renderer, [&] { renderSettingsBackdrop(renderer, background, session.playerChar, marioSprite, luigiSprite); });
+        renderSettingsScreen(renderer);
+        break;
+    case ABOUT:
+        layer.render(renderer, [&] { renderAboutBackdrop(renderer, background); });
+        break;
+    case LEVEL_SELECT:
+        layer.render(renderer, [&] { renderLevelSelectBackdrop(renderer, session.levelFiles, background); });
+        renderLevelSelectScreen(renderer, session.levelFiles, levelRects);
+        break;
+    case LOST:
+        layer.render(renderer, [&] { renderLostBackdrop(renderer, session.deathReason); });
+        renderLostScreen(renderer, session.deathReason);
+        break;
+    default:
+        layer.render(renderer, [&] { renderWinningBackdrop(renderer, session.isLastLevel); });
+        renderWinningScreen(renderer, session.isLastLevel);
+        break;
+    }
+    present(renderer);
 }
 //NOLINTEND(bugprone-integer-division)
 
-vector<SDL_Texture*> loadBackgroundTextures(SDL_Renderer* renderer, const string& folderPath) {
-    vector<SDL_Texture*> backgroundTextures;
-    for (const auto& entry : directory_iterator(folderPath)) {
+// The .png files in root/folder, as paths relative to root
+vector<string> pngFiles(const string& root, const string& folder) {
+    vector<string> files;
+    for (const auto& entry : directory_iterator(root + folder)) {
         if (entry.path().extension() == ".png") {
-            // ReSharper disable once CppTooWideScope
-            SDL_Texture* texture = IMG_LoadTexture(renderer, entry.path().string().c_str());
-            if (texture) {
-                backgroundTextures.push_back(texture);
-            } else {
-                cerr << "Failed to load texture: " << entry.path() << " " << SDL_GetError() << endl;
-            }
+            files.push_back(folder + "/" + entry.path().filename().string());
         }
     }
+    return files;
+}
 
-    // Manual bubble sort
-    for (size_t i = 0; i < backgroundTextures.size(); ++i) {
-        for (size_t j = 0; j < backgroundTextures.size() - i - 1; ++j) {
-            if (backgroundTextures[j] > backgroundTextures[j + 1]) {
-                swap(backgroundTextures[j], backgroundTextures[j + 1]);
-            }
-        }
+// The background level levelIndex is played on
+size_t backgroundForLevel(int levelIndex, size_t count) {
+    if (levelIndex >= static_cast<int>(count) - 1) {
+        return 0;
     }
-    return backgroundTextures;
+    return levelIndex;
 }
 
-void changeBackground(const vector<SDL_Texture*>& backgrounds,vector<SDL_Texture*>& textures, const int& currentIndex) {
-    cout << "Changing background to: " << ((currentIndex + 1) % backgrounds.size()) << endl;
+void changeBackground(BackgroundCache& backgrounds, SDL_Texture*& background, const int& currentIndex) {
+    cout << "Changing background to: " << ((currentIndex + 1) % backgrounds.count()) << endl;
     cout << "Current index: " << currentIndex << endl;
-    int index;
-    if (currentIndex >= backgrounds.size() - 1) {
-        index = 0;
+    size_t index = backgroundForLevel(currentIndex, backgrounds.count());
+    cout << "New index: " << index << endl;
+    // ReSharper disable once CppTooWideScope
+    SDL_Texture* texture = backgrounds.get(index);
+    if (texture) {
+        background = texture;
     } else {
-        index = currentIndex;
+        cerr << "Failed to load background " << index << ", keeping the current one: " << SDL_GetError() << endl;
     }
-    cout << "New index: " << index << endl;
-    textures[0] = backgrounds[index];
 }
 
-vector<SDL_Texture*> playerTextures = {};
-
-SDL_Texture* playerTextureLeft = nullptr;
-SDL_Texture* playerTextureRight = nullptr;
-SDL_Texture* playerTextureWalkingLeft = nullptr;
-SDL_Texture* playerTextureWalkingRight = nullptr;
-SDL_Texture* playerTextureLost = nullptr;
-SDL_Texture* playerTextureJumpingLeft = nullptr;
-SDL_Texture* playerTextureJumpingRight = nullptr;
-
-vector<SDL_Texture*> switchCharacter(Character character, SDL_Renderer* renderer) {
+// The level sprites in GameSession::sprites order
+const char* const levelSpritePaths[] = { "resources/brick.png", "resources/vine.png", "resources/star-coin.png", "resources/enemy/left.png",
+                                         "resources/enemy/right.png", "resources/door/closed.png", "resources/door/open.png", "resources/life.png" };
+// In GameSession::playerSprites order
+const char* const playerSpriteNames[] = { "left", "right", "walkingleft", "walkingright", "lost", "jumpingleft", "jumpingright" };
+// In AudioCue order
+const char* const soundPaths[] = { "resources/sounds/lost.wav", "resources/sounds/coin.mp3", "resources/sounds/clear.mp3", "resources/sounds/won.mp3",
+                                   "resources/sounds/jump.wav", "resources/sounds/kill.mp3", "resources/sounds/steps.mp3" };
+// Where the loose files are found when there is no asset pack, relative to the working directory
+const string looseRoot = "../";
+
+string playerSpritePath(Character character, const char* name) {
     string characterStr = (character == mario) ? "mario" : "luigi";
+    return "resources/player/" + characterStr + "/" + name + ".png";
+}
 
-    for (auto texture : playerTextures) {
-        SDL_DestroyTexture(texture);
-    }
-    playerTextures.clear();
+// marioSDL.pak next to the executable, so running from anywhere finds it
+string assetPackPath() {
+    char* basePath = SDL_GetBasePath();
+    string path = basePath ? string(basePath) + "marioSDL.pak" : "marioSDL.pak";
+    SDL_free(basePath);
+    return path;
+}
 
-    playerTextureLeft = IMG_LoadTexture(renderer, ("../resources/player/" + characterStr + "/left.png").c_str());
-    playerTextureRight = IMG_LoadTexture(renderer, ("../resources/player/" + characterStr + "/right.png").c_str());
-    playerTextureWalkingLeft = IMG_LoadTexture(renderer, ("../resources/player/" + characterStr + "/walkingleft.png").c_str());
-    playerTextureWalkingRight = IMG_LoadTexture(renderer, ("../resources/player/" + characterStr + "/walkingright.png").c_str());
-    playerTextureLost = IMG_LoadTexture(renderer, ("../resources/player/" + characterStr + "/lost.png").c_str());
-    playerTextureJumpingLeft = IMG_LoadTexture(renderer, ("../resources/player/" + characterStr + "/jumpingleft.png").c_str());
-    playerTextureJumpingRight = IMG_LoadTexture(renderer, ("../resources/player/" + characterStr + "/jumpingright.png").c_str());
+// The pack's copy of name when it has one, otherwise the loose file
+TTF_Font* openFont(const AssetPack* pack, const string& name, int size) {
+    if (const AssetPackEntry* entry = pack ? pack->find(name) : nullptr; entry && entry->kind == ASSET_FILE) {
+        return TTF_OpenFontRW(SDL_RWFromConstMem(pack->data(*entry), static_cast<int>(entry->size)), 1, size);
+    }
+    return TTF_OpenFont((looseRoot + name).c_str(), size);
+}
 
-    playerTextures = { playerTextureLeft, playerTextureRight, playerTextureWalkingLeft, playerTextureWalkingRight, playerTextureLost, playerTextureJumpingLeft, playerTextureJumpingRight };
+// Straight from the pack's PCM when it was converted for the format the mixer is open with,
+// otherwise decoded from the loose file
+Mix_Chunk* loadSound(const AssetPack* pack, const string& name) {
+    if (const AssetPackEntry* entry = pack ? pack->find(name) : nullptr; entry && entry->kind == ASSET_SOUND && pack->matchesMixer()) {
+        return Mix_QuickLoad_RAW(const_cast<Uint8*>(pack->data(*entry)), static_cast<Uint32>(entry->size)); // the mixer only reads it
+    }
+    return Mix_LoadWAV((looseRoot + name).c_str());
+}
 
-    for (auto& texture : playerTextures) {
-        if (!texture) {
+// The player sprites in the order GameSession::playerSprites has them, empty if one failed to load
+vector<SpriteHandle> loadCharacter(AssetCache& assets, Character character) {
+    vector<SpriteHandle> sprites;
+    for (const char* name : playerSpriteNames) {
+        SpriteHandle sprite = assets.sprite(playerSpritePath(character, name));
+        if (!sprite) {
             cerr << "Failed to load textures!" << endl << SDL_GetError() << endl;
-            SDL_Quit();
-            return vector<SDL_Texture*>(-1);
+            return {};
         }
+        sprites.push_back(sprite);
     }
+    return sprites;
+}
 
-    return playerTextures;
+// Both characters are loaded at startup, switching only hands out the other one's sprites
+vector<const Sprite*> switchCharacter(Character character, const vector<SpriteHandle> (&characterSprites)[2]) {
+    vector<const Sprite*> playerSprites;
+    for (const auto& sprite : characterSprites[character == mario ? mario : luigi]) {
+        playerSprites.push_back(sprite.get());
+    }
+    return playerSprites;
 }
 
-int main() {
+int main(int argc, char* argv[]) {
+    vector<string> args(argv + 1, argv + argc);
+    if (!args.empty() && args[0] == "--headless") {
+        return runHeadless(vector(args.begin() + 1, args.end()));
+    }
+    string recordPath;
+    string replayPath;
+    size_t backgroundBudget = 2048 * 1024; // the current background and the next level's
+    PacingMode pacing = PACING_VSYNC;
+    int fpsCap = 60;
+    int checkAllocationsAfter = -1;
+    for (size_t i = 0; i < args.size(); i += 2) {
+        if (args[i] == "--record" && i + 1 < args.size()) {
+            recordPath = args[i + 1];
+        } else if (args[i] == "--replay" && i + 1 < args.size()) {
+            replayPath = args[i + 1];
+        } else if (args[i] == "--background-budget" && i + 1 < args.size()) {
+            backgroundBudget = stoul(args[i + 1]) * 1024;
+        } else if (args[i] == "--pacing" && i + 1 < args.size()) {
+            if (!parsePacingMode(args[i + 1], pacing)) {
+                cerr << "Unknown pacing mode " << args[i + 1] << ", expected vsync, cap or uncapped" << endl;
+                return 2;
+            }
+        } else if (args[i] == "--fps" && i + 1 < args.size()) {
+            fpsCap = stoi(args[i + 1]);
+        } else if (args[i] == "--check-allocations" && i + 1 < args.size()) {
+            // Aborts when a frame allocates once the game has been playing for this many frames in a row
+            checkAllocationsAfter = stoi(args[i + 1]);
+            if (!countingAllocations) {
+                cerr << "--check-allocations needs a build that counts allocations, a Debug build or -DMARIO_COUNT_ALLOCATIONS=ON" << endl;
+                return 2;
+            }
+        } else {
+            cerr << "usage: marioSDL [--record FILE | --replay FILE] [--background-budget KIB] [--pacing vsync|cap|uncapped] [--fps N] [--check-allocations FRAMES]" << endl
+                 << "       marioSDL --headless ..." << endl;
+            return 2;
+        }
+    }
+
+    profiler.nameThread("main");
+    Uint64 startCounter = SDL_GetPerformanceCounter();
+    auto msSinceStart = [startCounter] { return static_cast<double>(SDL_GetPerformanceCounter() - startCounter) * 1000 / SDL_GetPerformanceFrequency(); };
+
     // init stuff
     SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO);
     window = SDL_CreateWindow("Mario", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, SCREEN_WIDTH, SCREEN_HEIGHT, SDL_WINDOW_SHOWN);
-    renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
+    renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED | (pacing == PACING_VSYNC ? SDL_RENDERER_PRESENTVSYNC : 0));
+    if (SDL_RendererInfo info; pacing == PACING_VSYNC && SDL_GetRendererInfo(renderer, &info) == 0 && !(info.flags & SDL_RENDERER_PRESENTVSYNC)) {
+        cerr << "VSync is not available, capping at " << fpsCap << " fps instead" << endl;
+        pacing = PACING_CAP;
+    }
     IMG_Init(IMG_INIT_PNG);
-    Mix_OpenAudio(44100, MIX_DEFAULT_FORMAT, 2, 2048);
+    Mix_OpenAudio(mixerFrequency, mixerFormat, mixerChannels, 2048);
     TTF_Init();
-    font = TTF_OpenFont("../resources/font/firacode.ttf", 24);
+    double initMs = msSinceStart();
+
+    // The build packs every asset, already decoded, into one file the game maps. Without it
+    // everything is read from the loose files.
+    AssetPack assetPack(assetPackPath());
+    const AssetPack* pack = assetPack.isOpen() ? &assetPack : nullptr;
+    setLevelPack(pack);
+
+    // Every loose image and sound the game starts with is decoded on the pool while this thread builds
+    // the glyph atlas, only the texture uploads have to happen here
+    ThreadPool pool;
+    AssetCache assets(renderer, spriteAtlas, pack, looseRoot); // every texture stays resident while main holds its handle
+    vector<string> backgroundFiles = pack ? pack->names("resources/backgrounds/") : pngFiles(looseRoot, "resources/backgrounds");
+    ranges::sort(backgroundFiles);
+    if (backgroundFiles.empty()) {
+        cerr << "No backgrounds found in resources/backgrounds!" << endl;
+        SDL_Quit();
+        return -1;
+    }
+    vector<string> startupImages = { backgroundFiles[0] }; // the rest are loaded when a level needs them
+    startupImages.insert(startupImages.end(), begin(levelSpritePaths), end(levelSpritePaths));
+    for (Character character : { mario, luigi }) {
+        for (const char* name : playerSpriteNames) {
+            startupImages.push_back(playerSpritePath(character, name));
+        }
+    }
+    assets.prefetch(startupImages, pool);
+    vector<future<Mix_Chunk*>> decodedSounds;
+    for (const char* path : soundPaths) {
+        decodedSounds.push_back(pool.submit([pack, path] { return loadSound(pack, path); }));
+    }
 
-    vector<SDL_Texture*> backgroundTextures = loadBackgroundTextures(renderer, "../resources/backgrounds");
-    int currentBackgroundIndex = 0;
+    font = openFont(pack, "resources/font/firacode.ttf", 24);
+    if (!textAtlas.build(renderer, font)) {
+        cerr << "Failed to build the glyph atlas!" << endl << SDL_GetError() << endl;
+    }
+    double fontMs = msSinceStart();
 
-    SDL_Texture* brickTexture = IMG_LoadTexture(renderer, "../resources/brick.png");
-    SDL_Texture* vineTexture = IMG_LoadTexture(renderer, "../resources/vine.png");
-    SDL_Texture* starCoinTexture = IMG_LoadTexture(renderer, "../resources/star-coin.png");
-    SDL_Texture* enemyTextureLeft = IMG_LoadTexture(renderer, "../resources/enemy/left.png");
-    SDL_Texture* enemyTextureRight = IMG_LoadTexture(renderer, "../resources/enemy/right.png");
-    SDL_Texture* doorTextureClosed = IMG_LoadTexture(renderer, "../resources/door/closed.png");
-    SDL_Texture* doorTextureOpen = IMG_LoadTexture(renderer, "../resources/door/open.png");
-    SDL_Texture* lifeTexture = IMG_LoadTexture(renderer, "../resources/life.png");
+    BackgroundCache backgrounds(assets, std::move(backgroundFiles), backgroundBudget);
 
-    vector textures = { backgroundTextures[currentBackgroundIndex], brickTexture, vineTexture, starCoinTexture, enemyTextureLeft, enemyTextureRight, doorTextureClosed, doorTextureOpen, lifeTexture };
+    SDL_Texture* background = backgrounds.get(0);
+    vector<SpriteHandle> levelSprites;
+    vector<const Sprite*> sprites;
+    for (const char* path : levelSpritePaths) {
+        levelSprites.push_back(assets.sprite(path));
+        sprites.push_back(levelSprites.back().get());
+    }
+    const Sprite* lifeSprite = sprites[7];
 
-    for (auto& texture : textures) {
-        if (!texture) {
-            cerr << "Failed to load textures!" << endl << SDL_GetError() << endl;
+    if (!background || ranges::find(sprites, nullptr) != sprites.end()) {
+        cerr << "Failed to load textures!" << endl << SDL_GetError() << endl;
+        SDL_Quit();
+        return -1;
+    }
+    vector<SpriteHandle> characterSprites[2];
+    for (Character character : { mario, luigi }) {
+        characterSprites[character] = loadCharacter(assets, character);
+        if (characterSprites[character].empty()) {
             SDL_Quit();
             return -1;
         }
     }
+    spriteAtlas.pack(renderer);
+    double imagesMs = msSinceStart();
 
     // load music
-    Mix_Music* soundtrack = Mix_LoadMUS("../resources/sounds/soundtrack.mp3");
-    Mix_Chunk* lostSound = Mix_LoadWAV("../resources/sounds/lost.wav");
-    Mix_Chunk* coinSound = Mix_LoadWAV("../resources/sounds/coin.mp3");
-    Mix_Chunk* clearSound = Mix_LoadWAV("../resources/sounds/clear.mp3");
-    Mix_Chunk* wonSound = Mix_LoadWAV("../resources/sounds/won.mp3");
-    Mix_Chunk* jumpSound = Mix_LoadWAV("../resources/sounds/jump.wav");
-    Mix_Chunk* killSound = Mix_LoadWAV("../resources/sounds/kill.mp3");
-    Mix_Chunk* stepSound = Mix_LoadWAV("../resources/sounds/steps.mp3");
-    vector sounds = { lostSound, coinSound, clearSound, wonSound, jumpSound, killSound, stepSound };
+    Mix_Music* soundtrack = Mix_LoadMUS((looseRoot + "resources/sounds/soundtrack.mp3").c_str()); // streamed, so never packed
+    vector<Mix_Chunk*> sounds;
+    for (auto& decoded : decodedSounds) {
+        sounds.push_back(decoded.get());
+    }
+    double soundsMs = msSinceStart();
 
     Mix_VolumeMusic(64);
-    Mix_VolumeChunk(coinSound, 64);
-    Mix_VolumeChunk(clearSound, 64);
-    Mix_VolumeChunk(wonSound, 64);
+    Mix_VolumeChunk(sounds[CUE_COIN], 64);
+    Mix_VolumeChunk(sounds[CUE_CLEAR], 64);
+    Mix_VolumeChunk(sounds[CUE_WON], 64);
     Mix_PlayMusic(soundtrack, -1);
-    bool musicPlaying = true;
-    bool soundPlayed = false;
-
-    // vectors for all GameObjects and Enemies, init player, bools and gravity
-    vector<GameObject> gameObjects;
-    vector<Enemy> enemies;
-    GameObject player{};
-    GameObject door{};
-    bool isOnGround = true;
-    bool canDoubleJump = false;
-    bool jumped = false;
-    bool isWalkingLeft = false;
-    float gravity = 0.8;
-    Sint32 levelStartTime = 0;
-    Sint32 lastJumpTime = 0;
-    Sint32 lastStepTime = 0;
-    Sint32 dyingStartTime = 0;
-    Sint32 transitionStartTime = 0;
-    string deathReason;
-    bool noMoreLives = false;
-
-    // vector for all the level files, init selected index, game state, level rects, current level index and is last level
-    vector<string> levelFiles = getLevelFiles("../levels");
-    GameState gameState = START_SCREEN;
-    GameMode gameMode = NORMAL;
+
+    // the session owns the level and all gameplay state, main only draws it and plays its sounds
+    GameSession session;
+    ThreadPool simulationPool; // its own, so a tick never waits behind a background decode
+    session.workers = &simulationPool;
+    session.levelFiles = pack ? pack->names("levels/") : getLevelFiles(looseRoot + "levels");
+    session.background = background;
+    session.sprites = sprites;
+    const vector<string>& levelFiles = session.levelFiles;
     vector<SDL_Rect> levelRects;
-    int currentLevelIndex = 0;
-    bool isLastLevel = false;
 
-    bool quit = false;
+    // --record saves every run to a file, --replay plays one back instead of taking input
+    InputRecorder recorder(recordPath);
+    optional<InputReplayer> replayer;
+    if (!replayPath.empty()) {
+        try {
+            Recording recording = readRecording(replayPath);
+            session.playerChar = static_cast<Character>(recording.header.character);
+            session.playerSprites = switchCharacter(session.playerChar, characterSprites);
+            replayer.emplace(std::move(recording));
+            replayer->begin(session);
+        } catch (const exception& ex) {
+            cerr << ex.what() << endl;
+            SDL_Quit();
+            return -1;
+        }
+    }
+    bool showStats = false;
+    bool showProfiler = false;
+    int tracesWritten = 0;
+    int prefetchedLevel = -1;
+    bool startupReported = false;
+    RenderStats lastFrameStats;
+    int replayFrames = 0;
+    double replayFrameSeconds = 0;
+    double replayMaxFrameSeconds = 0;
+
     SDL_Event e;
 
-    while (!quit) {
-        Sint32 currentTime = SDL_GetTicks();
-        while (SDL_PollEvent(&e) != 0) {
+    // Real time not yet simulated, consumed TICK_SECONDS at a time
+    double accumulator = 0;
+    Uint64 lastFrameCounter = SDL_GetPerformanceCounter();
+    FramePacer pacer(pacing, fpsCap);
+    // The menus sleep in SDL_WaitEventTimeout once drawn, until an event could change them
+    bool menuIdle = false;
+    bool redrawMenu = true;
+    MenuView drawnMenu;
+    int drawnHover = -1;
+    // What the main thread allocated during the last frame, only counted in builds with MARIO_COUNT_ALLOCATIONS
+    uint64_t frameStartAllocations = threadAllocations();
+    uint64_t lastFrameAllocations = 0;
+    int playingFrames = 0; // in a row, for --check-allocations
+
+    while (!session.quit) {
+        Uint64 frameCounter = SDL_GetPerformanceCounter();
+        double frameSeconds = static_cast<double>(frameCounter - lastFrameCounter) / SDL_GetPerformanceFrequency();
+        // A long stall (window drag, breakpoint) is dropped rather than simulated all at once
+        accumulator += min(frameSeconds, 0.25);
+        lastFrameCounter = frameCounter;
+        if (replayer) {
+            ++replayFrames;
+            replayFrameSeconds += frameSeconds;
+            replayMaxFrameSeconds = max(replayMaxFrameSeconds, frameSeconds);
+        }
+
+        bool gotEvent = menuIdle ? SDL_WaitEventTimeout(&e, menuWakeMs) != 0 : SDL_PollEvent(&e) != 0;
+        for (; gotEvent; gotEvent = SDL_PollEvent(&e) != 0) {
             if (e.type == SDL_QUIT) {
-                quit = true;
+                session.quit = true;
             }
-            if (e.type == SDL_KEYDOWN) { // handle key presses for each game state
-                switch (e.key.keysym.sym) {
-                case SDLK_m:
-                    if (musicPlaying) {
-                        Mix_PauseMusic();
-                    } else {
-                        Mix_ResumeMusic();
-                    }
-                    musicPlaying = !musicPlaying;
-                    break;
-                default: break;
-                }
-                if (gameState == START_SCREEN) {
-                    switch (e.key.keysym.sym) {
-                    case SDLK_ESCAPE:
-                        quit = true;
-                        break;
-                    default: break;
-                    }
-                } else if (gameState == SETTINGS || gameState == MODE_SELECT) {
-                    switch (e.key.keysym.sym) {
-                    case SDLK_ESCAPE:
-                        gameState = START_SCREEN;
-                        break;
-                    default: break;
-                    }
-                } else if (gameState == LEVEL_SELECT) {
-                    switch (e.key.keysym.sym) {
-                    case SDLK_ESCAPE:
-                        gameState = MODE_SELECT;
-                        break;
-                    default: break;
-                    }
-                } else if (gameState == ABOUT) {
-                    switch (e.key.keysym.sym) {
-                        case SDLK_ESCAPE:
-                            gameState = SETTINGS;
-                            break;
-                        default: break;
-                    }
-                } else if ((gameState == WON || gameState == LOST) && e.key.keysym.sym == SDLK_SPACE) {
-                    // ReSharper disable once CppExpressionWithoutSideEffects
-                    // ReSharper disable once CppDFAConstantConditions
-                    gameState == START_SCREEN;
-                } else if (gameState == DYING) {
-                    if (e.key.keysym.sym == SDLK_SPACE) {
-                        gameState = LOST;
-                    }
-                } else if (gameState == PLAYING) {
-                    Sint32 stepCooldown = 685.877;
-                    SDL_FRect newRect = player.rect;
-                    float moveSpeed = TILE_SIZE;
-
-                    switch (e.key.keysym.sym) {
-                    case SDLK_SPACE:
-                        if (isOnGround) {
-                            if (isWalkingLeft) {
-                                player.texture = playerTextures[5];
-                            } else {
-                                player.texture = playerTextures[6];
-                            }
-                            Mix_PlayChannel(-1, jumpSound, 0);
-                            gravity = 0.04;
-                            isOnGround = false;
-                            jumped = true;
-                            canDoubleJump = true;
-                            newRect.y -= moveSpeed; // first jump
-                            lastJumpTime = currentTime;
-                        } else if (canDoubleJump && (currentTime - lastJumpTime) < 500) {
-                            Mix_PlayChannel(-1, jumpSound, 0);
-                            newRect.y -= moveSpeed;  // Double jump
-                            jumped = true;
-                            canDoubleJump = false;
-                        }
-                        break;
-                    case SDLK_w:
-                        if (hasIntersection(player.rect, door.rect) && collectedCoins == totalCoins) {
-                            gameState = TRANSITION;
-                            transitionStartTime = currentTime;
-                            door.texture = doorTextureOpen;
-                        } else { newRect.y -= moveSpeed; }
-                        break;
-                    case SDLK_s:
-                        newRect.y += moveSpeed;
-                        break;
-                    case SDLK_a:
-                        newRect.x -= moveSpeed;
-                        player.texture = playerTextureWalkingLeft;
-                        if (currentTime - lastStepTime > stepCooldown) {
-                            Mix_PlayChannel(-1, stepSound, 0);
-                            lastStepTime = currentTime;
-                        }
-                        isWalkingLeft = true;
-                        break;
-                    case SDLK_d:
-                        newRect.x += moveSpeed;
-                        player.texture = playerTextureWalkingRight;
-                        if (currentTime - lastStepTime > stepCooldown) {
-                            Mix_PlayChannel(-1, stepSound, 0);
-                            lastStepTime = currentTime;
-                        }
-                        isWalkingLeft = false;
-                        break;
-                    case SDLK_p:
-                        collectedCoins = totalCoins;
-                        break;
-                    case SDLK_o:
-                        collectedCoins = totalCoins;
-                        isLastLevel = true;
-                        gameState = WON;
-                        break;
-                    case SDLK_l:
-                        if (musicPlaying) {
-                            Mix_HaltMusic();
-                            Mix_VolumeMusic(64);
-                            Mix_PlayChannel(-1, lostSound, 0);
-                            musicPlaying = false;
-                        }
-                        dyingStartTime = currentTime;
-                        player.texture = playerTextures[4];
-                        gameState = DYING;
-                        break;
-                    case SDLK_ESCAPE:
-                        gameState = START_SCREEN;
-                        break;
-                    default: break;
-                    }
-
-                    // Ensure the player does not go out of the screen's bounds
-                    if (newRect.x < 0) newRect.x = 0;
-                    if (newRect.x + newRect.w > SCREEN_WIDTH) newRect.x = SCREEN_WIDTH - newRect.w;
-                    if (newRect.y < 0) newRect.y = 0;
-                    if (newRect.y + newRect.h > SCREEN_HEIGHT) newRect.y = SCREEN_HEIGHT - newRect.h;
-
-                    bool collision = false;
-
-                    // Check for collisions with other game objects
-                    for (const auto& obj : gameObjects) {
-                        if (obj.texture == starCoinTexture && hasIntersection(newRect, obj.rect)) {
-                            ++collectedCoins;
-                            erase_if(gameObjects, [&obj](const GameObject& o) {
-                                return &o == &obj;
-                            });
-                            Mix_PlayChannel(0, coinSound, 0); // Play the coin sound on any available channel
-                            break;
-                        }
-                        if (obj.texture == lifeTexture && hasIntersection(newRect, obj.rect)) {
-                            ++lives;
-                            erase_if(gameObjects, [&obj](const GameObject& o) {
-                                return &o == &obj;
-                            });
-                            Mix_PlayChannel(0, coinSound, 0); // Play the coin sound on any available channel
-                            break;
-                        }
-                        if (obj.texture != vineTexture && obj.texture != starCoinTexture && hasIntersection(newRect, obj.rect)) {
-                            collision = true;
-                            break;
-                        }
-                    }
-
-                    if (!collision) {
-                        player.rect = newRect;
-                    }
-
+            if (e.type == SDL_RENDER_TARGETS_RESET || e.type == SDL_RENDER_DEVICE_RESET) { // the baked chunks are gone
+                staticLayers.clear();
+                menuLayer.clear();
+            }
+            if (e.type == SDL_KEYDOWN || e.type == SDL_MOUSEBUTTONDOWN || e.type == SDL_RENDER_TARGETS_RESET || e.type == SDL_RENDER_DEVICE_RESET ||
+                (e.type == SDL_WINDOWEVENT && e.window.event == SDL_WINDOWEVENT_EXPOSED)) {
+                redrawMenu = true;
+            }
+            PROFILE_ZONE("event");
+            if (e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_F3) { // not game input, so never recorded
+                showStats = !showStats;
+                continue;
+            }
+            if (e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_F4) {
+                showProfiler = !showProfiler;
+                continue;
+            }
+            if (e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_F5) { // the zones still in the profiler's rings, for chrome://tracing
+                string tracePath = "marioSDL-trace-" + to_string(++tracesWritten) + ".json";
+                if (profiler.writeTrace(tracePath)) {
+                    cout << "Wrote " << tracePath << endl;
+                } else {
+                    cerr << "Failed to write " << tracePath << endl;
                 }
+                continue;
+            }
+            if (replayer) { // the recording is the only input
+                continue;
+            }
+            if (e.type == SDL_KEYDOWN) { // key presses drive the session directly
+                recorder.apply(session, INPUT_KEY, e.key.keysym.sym);
             } else if (e.type == SDL_MOUSEBUTTONDOWN) { // clicking with the mouse
                 int mouseX, mouseY;
                 SDL_GetMouseState(&mouseX, &mouseY);
 
-                if (gameState == LEVEL_SELECT) {
-                    for (int i = 0; i < levelRects.size(); ++i) {
+                if (session.state == LEVEL_SELECT) {
+                    for (size_t i = 0; i < levelRects.size(); ++i) {
                         if (isPointInRect(mouseX, mouseY, levelRects[i])) {
-                            currentLevelIndex = i + levelScrollOffset;
-                            gameObjects.clear();
-                            collectedCoins = 0;
-                            playerTextures = switchCharacter(playerChar, renderer);
-                            loadLevel(levelFiles[i], gameObjects, textures, playerTextures, enemies, player, door);
-                            gameState = PLAYING;
-                            levelStartTime = 0;
+                            int levelIndex = firstListedLevel(levelFiles) + static_cast<int>(i);
+                            session.playerSprites = switchCharacter(session.playerChar, characterSprites);
+                            recorder.begin(session, levelIndex);
+                            session.startLevel(levelIndex);
                             break;
                         }
                     }
-                    if (isPointInRect(mouseX, mouseY, leftArrowRect)) {
-                        levelScrollOffset = max(0, levelScrollOffset - 1);
-                    } else if (isPointInRect(mouseX, mouseY, rightArrowRect)) {
-                        Sint32 numberOfLevels = levelFiles.size();
-                        levelScrollOffset = min(numberOfLevels - 5, levelScrollOffset + 1);
+                    // The arrows are only there when the levels do not all fit
+                    if (levelFiles.size() > visibleLevels) {
+                        int lastScrollOffset = max(0, static_cast<int>(levelFiles.size()) - visibleLevels);
+                        if (isPointInRect(mouseX, mouseY, leftArrowRect)) {
+                            levelScrollOffset = max(0, levelScrollOffset - 1);
+                        } else if (isPointInRect(mouseX, mouseY, rightArrowRect)) {
+                            levelScrollOffset = max(0, min(lastScrollOffset, levelScrollOffset + 1));
+                        }
                     }
-                } else if (gameState == WON) {
+                } else if (session.state == WON) {
                     Mix_PauseMusic();
-                    if (isPointInRectF(mouseX, mouseY, nextLevelButton)) {
-                        if (soundPlayed) {
-                            Mix_HaltGroup(-1);
-                        }
-                        ++currentLevelIndex;
-                        if (currentLevelIndex >= levelFiles.size()) {
-                            isLastLevel = true;
-                            gameState = WON;
-                        } else {
-                            totalCoins = 0;
-                            collectedCoins = 0;
-                            gameObjects.clear();
-                            enemies.clear();
-                            door.texture = doorTextureClosed;
-                            changeBackground(backgroundTextures, textures, currentLevelIndex);
-                            loadLevel(levelFiles[currentLevelIndex], gameObjects, textures, playerTextures, enemies, player, door);
-                            gameState = PLAYING;
-                            Mix_ResumeMusic();
-                            musicPlaying = true;
-                            soundPlayed = false;
-                        }
+                    if (isPointInRectF(mouseX, mouseY, nextLevelButton) && recorder.apply(session, INPUT_NEXT_LEVEL, 0)) {
+                        changeBackground(backgrounds, session.background, session.currentLevelIndex);
                     }
-                } else if (gameState == START_SCREEN) {
+                } else if (session.state == START_SCREEN) {
                     if (isButtonClicked(buttonRect(playButton), mouseX, mouseY)){
-                        gameState = MODE_SELECT;
+                        session.state = MODE_SELECT;
                     }
                     if (isButtonClicked(buttonRect(settingsButton), mouseX, mouseY)) {
-                        gameState = SETTINGS;
+                        session.state = SETTINGS;
                     }
-                } else if (gameState == SETTINGS) {
+                } else if (session.state == SETTINGS) {
                     if (isPointInRectF(mouseX, mouseY, marioRect)) {
-                        playerChar = mario;
+                        session.playerChar = mario;
                     } else if (isPointInRectF(mouseX, mouseY, luigiRect)) {
-                        playerChar = luigi;
+                        session.playerChar = luigi;
                     }
                     if (isButtonClicked(buttonRect(aboutButton), mouseX, mouseY)) {
-                        gameState = ABOUT;
+                        session.state = ABOUT;
                     }
-                } else if (gameState == MODE_SELECT) {
+                } else if (session.state == MODE_SELECT) {
                     if (isButtonClicked(buttonRect(normalModeButton), mouseX, mouseY)) {
-                        gameObjects.clear();
-                        enemies.clear();
-                        totalCoins = 0;
-                        collectedCoins = 0;
-                        playerTextures = switchCharacter(playerChar, renderer);
-                        loadLevel(levelFiles[0], gameObjects, textures, playerTextures, enemies, player, door);
-                        gameState = PLAYING;
-                        levelStartTime = 0;
+                        session.playerSprites = switchCharacter(session.playerChar, characterSprites);
+                        recorder.begin(session, 0);
+                        session.startLevel(0);
                     }
                     if (isButtonClicked(buttonRect(levelSelectButton), mouseX, mouseY)) {
-                        gameState = LEVEL_SELECT;
-                        gameMode = CUSTOM;
+                        session.state = LEVEL_SELECT;
+                        session.gameMode = CUSTOM;
                     }
-                } else if (gameState == LOST) {
+                } else if (session.state == LOST) {
                     if (isPointInRectF(mouseX, mouseY, buttonRect(retryLevelButton)) || isPointInRectF(mouseX, mouseY, buttonRect(tryAgainButton))) {
-                        totalCoins = 0;
-                        collectedCoins = 0;
-                        gameObjects.clear();
-                        enemies.clear();
-                        if (noMoreLives) {
-                            currentLevelIndex = 0;
-                            changeBackground(backgroundTextures, textures, currentLevelIndex);
-                            loadLevel(levelFiles[currentLevelIndex], gameObjects, textures, playerTextures, enemies, player, door);
-                        } else {
-                            loadLevel(levelFiles[currentLevelIndex], gameObjects, textures, playerTextures, enemies, player, door);
+                        if (recorder.apply(session, INPUT_RETRY, 0)) {
+                            changeBackground(backgrounds, session.background, session.currentLevelIndex);
                         }
-                        gameState = PLAYING;
-                        Mix_ResumeMusic();
-                        musicPlaying = true;
-                        soundPlayed = false;
                     }
                 }
             }
         }
-        if (gameState == START_SCREEN) {
-            renderStartScreen(renderer, textures[0]);
-        } else if (gameState == MODE_SELECT) {
-            renderModeSelectScreen(renderer, textures[0]);
-        } else if (gameState == SETTINGS) {
-            renderSettingsScreen(renderer, textures[0]);
-        } else if (gameState == ABOUT) {
-            renderAboutScreen(renderer, textures[0]);
-        } else if (gameState == LEVEL_SELECT) {
-            levelStartTime = 0;
-            renderLevelSelectScreen(renderer, levelFiles, levelRects, textures[0]);
-        } else if (gameState == PLAYING) {
-            constexpr Sint32 levelTimeLimit = 100000;
-            if (levelStartTime == 0) {
-                levelStartTime = SDL_GetTicks();
-            }
-
-            Sint32 remainingTime = (levelTimeLimit > (currentTime - levelStartTime)) ? (levelTimeLimit - (currentTime - levelStartTime)) / 1000 : 0;
 
-            if (levelStartTime > 0 && (currentTime - levelStartTime) > levelTimeLimit) {
-                if (musicPlaying) {
-                    Mix_PauseMusic();
-                    Mix_VolumeMusic(64);
-                    Mix_PlayChannel(-1, lostSound, 0);
-                    musicPlaying = false;
-                }
-                dyingStartTime = currentTime;
-                player.texture = playerTextures[4];
-                deathReason = "time";
-                gameState = DYING;
-            }
+        // The next level's background is decoded while this one is played
+        if (session.currentLevelIndex != prefetchedLevel) {
+            prefetchedLevel = session.currentLevelIndex;
+            backgrounds.prefetch(backgroundForLevel(prefetchedLevel + 1, backgrounds.count()), pool);
+        }
 
-            for (const auto& enemy : enemies) {
-                if (hasIntersection(player.rect, enemy.gameObject.rect)) {
-                    if (musicPlaying) {
-                        Mix_PauseMusic();
-                        Mix_VolumeMusic(64);
-                        Mix_PlayChannel(-1, lostSound, 0);
-                        musicPlaying = false;
-                    }
-                    dyingStartTime = currentTime;
-                    player.texture = playerTextures[4];
-                    deathReason = "enemy";
-                    gameState = DYING;
-                }
-            }
-            if ( jumped && isOnPlatform(player, gameObjects, brickTexture)) { // bs fix for jumping
-                isOnGround = true;
-                gravity = 0.15;
-                jumped = false;
+        // A run ends once the player is back in the menus
+        if (recorder.active() && session.inMenus()) {
+            recorder.finish();
+        }
 
-                if (isWalkingLeft) {
-                    player.texture = playerTextureLeft;
-                } else {
-                    player.texture = playerTextureRight;
+        // Advance the simulation in fixed ticks, as many as the real time since the last frame covers
+        {
+            PROFILE_ZONE("simulate");
+            while (accumulator >= TICK_SECONDS) {
+                accumulator -= TICK_SECONDS;
+                if (replayer && replayer->beforeTick(session)) {
+                    changeBackground(backgrounds, session.background, session.currentLevelIndex);
                 }
-            }
-            if (!isOnPlatform(player, gameObjects, brickTexture) && !isOnVine(player, gameObjects, vineTexture)) { // apply gravity
-                bool atTopOfVine = false;
-                SDL_FRect belowPlayer = player.rect;
-                belowPlayer.y += 1;
-
-                for (const auto& obj : gameObjects) {
-                    if (obj.texture == vineTexture && hasIntersection(belowPlayer, obj.rect)) {
-                        atTopOfVine = true;
+                session.tick();
+                recorder.tick(session);
+                if (replayer) {
+                    replayer->afterTick(session);
+                    if (replayer->finished()) {
+                        session.quit = true;
                         break;
                     }
                 }
-
-                if (!atTopOfVine) {
-                    if (currentTime - lastJumpTime > 500) {
-                        gravity = 0.8;
-                    }
-                    player.rect.y += gravity;
-                    if (player.rect.y + player.rect.h > SCREEN_HEIGHT) { // imagine falling off the screen :')
-                        player.rect.y = SCREEN_HEIGHT - player.rect.h;
-                    }
-                }
             }
-
-            // Calculate the y position of the last tile row
-            float lastTileRowY = (SCREEN_HEIGHT / TILE_SIZE - 1) * TILE_SIZE; // NOLINT(*-integer-division)
-
-            // Check if the player's y position is more than the last tile row's y position
-            if (player.rect.y >= lastTileRowY) {
-                if (musicPlaying) {
-                    Mix_PauseMusic();
-                    Mix_VolumeMusic(64);
-                    Mix_PlayChannel(-1, lostSound, 0);
-                    musicPlaying = false;
-                }
-                dyingStartTime = currentTime;
-                player.texture = playerTextures[4];
-                deathReason = "fall";
-                gameState = DYING;
+        }
+        float alpha = static_cast<float>(accumulator / TICK_SECONDS);
+        playAudioCues(session, sounds);
+
+        lastFrameStats = renderStats;
+        renderStats = {};
+        bool presented = true;
+        if (session.inMenus() || session.state == WON || session.state == LOST) {
+            int mouseX, mouseY;
+            SDL_GetMouseState(&mouseX, &mouseY);
+            MenuView view = menuView(session);
+            int hover = hoveredButton(session, mouseX, mouseY);
+            if (view != drawnMenu) {
+                menuLayer.invalidate();
+                redrawMenu = true;
             }
-
-            // render the screen and all the game objects
+            presented = redrawMenu || hover != drawnHover;
+            if (presented) {
+                renderMenu(renderer, session, menuLayer, *characterSprites[mario][0], *characterSprites[luigi][0], levelRects);
+                drawnMenu = view;
+                drawnHover = hover;
+                redrawMenu = false;
+            }
+        } else if (session.state == PLAYING) {
+            // render the screen and the game objects in view
             SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
             SDL_RenderClear(renderer);
+            renderWorld(renderer, session, alpha, true, true);
 
-            SDL_RenderCopyF(renderer, textures[0], nullptr, nullptr);
-            for (const auto& obj : gameObjects) {
-                SDL_RenderCopyF(renderer, obj.texture, nullptr, &obj.rect);
+            renderHud(renderer, session, *lifeSprite);
+            if (showStats) {
+                renderStatsOverlay(renderer, lastFrameStats, assets.stats(), backgrounds, pacer, lastFrameAllocations);
             }
-            SDL_RenderCopyF(renderer, door.texture, nullptr, &door.rect);
-            SDL_RenderCopyF(renderer, player.texture, nullptr, &player.rect);
-
-            updateEnemies(enemies, player, killSound);
-            for (const auto& enemy : enemies) {
-                SDL_RenderCopyF(renderer, enemy.gameObject.texture, nullptr, &enemy.gameObject.rect);
+            if (showProfiler) {
+                renderProfilerOverlay(renderer);
             }
 
-            // Render the remaining time on the screen
-            char* timeText = new char[("Time: " + to_string(remainingTime)).length() + 1];
-            strcpy(timeText, ("Time: " + to_string(remainingTime)).c_str());
-
-            renderText(renderer, timeText, SCREEN_WIDTH / 2 - calcOffset(strlen(timeText)), SCREEN_HEIGHT - 32); // NOLINT(*-integer-division)
-            delete[] timeText;
-
-            // draw the coin counter and level text
-            string coinText = "Coins: " + to_string(collectedCoins) + "/" + to_string(totalCoins);
-            string atLevel = "Level: " + to_string(currentLevelIndex + 1);
-            renderText(renderer, coinText, 10, SCREEN_HEIGHT - 32);
-            renderText(renderer, atLevel, SCREEN_WIDTH - 124, SCREEN_HEIGHT - 32);
-
-            for (int i = 0; i < lives; ++i) {
-                SDL_Rect lifeRect = { SCREEN_WIDTH - (i + 1) * (TILE_SIZE + 5), 10, TILE_SIZE, TILE_SIZE };
-                SDL_RenderCopy(renderer, lifeTexture, nullptr, &lifeRect);
+            present(renderer);
+        } else if (session.state == TRANSITION || session.state == DYING) {
+            SDL_RenderClear(renderer);
+            renderWorld(renderer, session, alpha, session.state == TRANSITION, false);
+            renderFade(renderer, session.fadeProgress());
+            if (showStats) {
+                renderStatsOverlay(renderer, lastFrameStats, assets.stats(), backgrounds, pacer, lastFrameAllocations);
             }
-
-            SDL_RenderPresent(renderer);
-        } else if (gameState == TRANSITION) {
-
-            float transitionDuration = 2000;
-            // ReSharper disable once CppTooWideScopeInitStatement
-            float progress = (currentTime - transitionStartTime) / transitionDuration;
-
-            if (progress >= 1.0f) {
-                gameState = WON;
-            } else {
-                if (currentLevelIndex >= levelFiles.size() -1 ) {
-                    isLastLevel = true;
-                    if (!soundPlayed) {
-                        Mix_PauseMusic();
-                        Mix_PlayChannel(-1, clearSound, 0);
-                        soundPlayed = true;
-                    }
-                }
-                if (!soundPlayed) {
-                    Mix_PauseMusic();
-                    Mix_PlayChannel(-1, wonSound, 0);
-                    soundPlayed = true;
-                }
-
-                SDL_RenderClear(renderer);
-
-                // Render the player and other game objects here
-                SDL_RenderCopyF(renderer, textures[0], nullptr, nullptr);
-                for (const auto& obj : gameObjects) {
-                    SDL_RenderCopyF(renderer, obj.texture, nullptr, &obj.rect);
-                }
-                SDL_RenderCopyF(renderer, door.texture, nullptr, &door.rect);
-                SDL_RenderCopyF(renderer, player.texture, nullptr, &player.rect);
-
-                // Apply the fade effect
-                Uint8 alpha = progress * 255;
-                SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
-                SDL_SetRenderDrawColor(renderer, 0, 0, 0, alpha);
-                SDL_RenderFillRect(renderer, nullptr);
-
-                SDL_RenderPresent(renderer);
+            if (showProfiler) {
+                renderProfilerOverlay(renderer);
             }
-        } else if (gameState == DYING) {
-            float dyingDuration = 2000;
-            // ReSharper disable once CppTooWideScopeInitStatement
-            float progress = (currentTime - dyingStartTime) / dyingDuration;
-
-            if (progress >= 1.0f) {
-                gameState = LOST;
-                --lives;
-                if (lives <= 0) {
-                    noMoreLives = true;
-                    deathReason = "lives";
-                }
-            } else {
-                if (progress < 0.2f) {
-                    player.rect.y += 0;
-                }
-                else if (progress < 0.5f) {
-                    player.rect.y -= 0.02; // Move the player up
-                } else if (progress > 0.5f){
-                    player.rect.y += 0.09; // Move the player down faster
-                }
-
-                SDL_RenderClear(renderer);
+            present(renderer);
+        }
 
-                // Render the player and other game objects here
-                SDL_RenderCopyF(renderer, textures[0], nullptr, nullptr);
-                for (const auto& obj : gameObjects) {
-                    SDL_RenderCopyF(renderer, obj.texture, nullptr, &obj.rect);
-                }
-                SDL_RenderCopyF(renderer, player.texture, nullptr, &player.rect);
+        if (!startupReported) {
+            startupReported = true;
+            cout << "Startup: SDL init " << initMs << " ms, font " << fontMs - initMs << " ms, images " << imagesMs - fontMs << " ms, sounds "
+                 << soundsMs - imagesMs << " ms, first frame at " << msSinceStart() << " ms (" << startupImages.size() << " images and "
+                 << sounds.size() << " sounds " << (pack ? "from the asset pack" : "decoded on " + to_string(pool.size()) + " threads") << ")" << endl;
+        }
+        // A replay keeps going on its own, the menus have to wait for the player
+        menuIdle = !presented && !replayer;
+        if (presented) {
+            pacer.endFrame();
+            profiler.endFrame();
+        } else {
+            pacer.skipFrame();
+        }
 
-                // Apply the fade effect
-                Uint8 alpha = progress * 255;
-                SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
-                SDL_SetRenderDrawColor(renderer, 0, 0, 0, alpha);
-                SDL_RenderFillRect(renderer, nullptr);
+        // Starting a level, dying and the menus may allocate, a frame of play should not once the
+        // caches have warmed up
+        uint64_t allocations = threadAllocations();
+        lastFrameAllocations = allocations - frameStartAllocations;
+        frameStartAllocations = allocations;
+        playingFrames = session.state == PLAYING ? playingFrames + 1 : 0;
+        if (checkAllocationsAfter >= 0 && playingFrames > checkAllocationsAfter && lastFrameAllocations > 0) {
+            cerr << "A frame allocated " << lastFrameAllocations << " times after " << playingFrames - 1 << " frames of play" << endl;
+            abort();
+        }
+    }
 
-                SDL_RenderPresent(renderer);
-            }
-        } else if (gameState == LOST) {
-            levelStartTime = 0;
-            renderLostScreen(renderer, deathReason);
-        } else {
-            levelStartTime = 0;
-            if (gameMode == CUSTOM) { isLastLevel = false; }
-            renderWinningScreen(renderer, isLastLevel);
+    recorder.finish();
+    if (replayer) {
+        cout << "Replayed " << replayer->ticks() << " ticks in " << replayFrames << " frames, mean frame "
+             << replayFrameSeconds * 1000 / max(replayFrames, 1) << " ms, max " << replayMaxFrameSeconds * 1000 << " ms" << endl;
+        if (replayer->divergedAt() >= 0) {
+            cout << "Diverged from the recording at tick " << replayer->divergedAt() << endl;
         }
     }
 
+    FramePacer::Stats frames = pacer.total();
+    cout << "Frames: " << frames.times.frames << " (" << pacingModeName(pacer.mode()) << "), mean " << frames.times.meanMs << " ms, p99 " << frames.times.p99Ms
+         << " ms, max " << frames.times.maxMs << " ms, CPU " << static_cast<int>(frames.cpuPercent) << "%" << endl;
+    const BackgroundCache::Stats& residency = backgrounds.stats();
+    cout << "Backgrounds: " << residency.loads << " loads, " << residency.evictions << " evictions, peak " << residency.peakBytes / 1024 << " KiB of a "
+         << backgrounds.budgetBytes() / 1024 << " KiB budget" << endl;
+
     // free up resources
     Mix_FreeMusic(soundtrack);
     for (auto sound : sounds ) {
         Mix_FreeChunk(sound);
     }
-    for (auto texture : playerTextures) {
-        SDL_DestroyTexture(texture);
-    }
-    for (auto texture : textures) {
-        SDL_DestroyTexture(texture);
-    }
+    // the handles go before the atlas their sprites live in
+    backgrounds.clear();
+    characterSprites[mario].clear();
+    characterSprites[luigi].clear();
+    levelSprites.clear();
+    spriteAtlas.destroy();
+    textAtlas.destroy();
+    staticLayers.clear();
     SDL_DestroyRenderer(renderer);
     SDL_DestroyWindow(window);
     TTF_CloseFont(font);
@@ -1218,4 +1220,4 @@ int main() {
     SDL_Quit();
     return 0;
 }
-//NOLINTEND(cppcoreguidelines-narrowing-conversions)
\ No newline at end of file
+//NOLINTEND(cppcoreguidelines-narrowing-conversions)
@@ -0,0 +1,104 @@
+#include "mappedfile.h"
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+#ifdef _WIN32
+MappedFile::MappedFile(const string& path) {
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return;
+    }
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+        CloseHandle(file);
+        return;
+    }
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping) {
+        CloseHandle(file);
+        return;
+    }
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!view) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return;
+    }
+    file_ = file;
+    mapping_ = mapping;
+    data_ = static_cast<const uint8_t*>(view);
+    size_ = static_cast<size_t>(fileSize.QuadPart);
+}
+
+void MappedFile::close() {
+    if (data_) {
+        UnmapViewOfFile(data_);
+        CloseHandle(mapping_);
+        CloseHandle(file_);
+    }
+    data_ = nullptr;
+    size_ = 0;
+    file_ = mapping_ = nullptr;
+}
+#else
+MappedFile::MappedFile(const string& path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+    struct stat st{};
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        void* view = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (view != MAP_FAILED) {
+            data_ = static_cast<const uint8_t*>(view);
+            size_ = static_cast<size_t>(st.st_size);
+        }
+    }
+    // The mapping keeps the file alive on its own
+    ::close(fd);
+}
+
+void MappedFile::close() {
+    if (data_) {
+        munmap(const_cast<uint8_t*>(data_), size_);
+    }
+    data_ = nullptr;
+    size_ = 0;
+}
+#endif
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+    : data_(exchange(other.data_, nullptr)), size_(exchange(other.size_, 0)) {
+#ifdef _WIN32
+    file_ = exchange(other.file_, nullptr);
+    mapping_ = exchange(other.mapping_, nullptr);
+#endif
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        close();
+        data_ = exchange(other.data_, nullptr);
+        size_ = exchange(other.size_, 0);
+#ifdef _WIN32
+        file_ = exchange(other.file_, nullptr);
+        mapping_ = exchange(other.mapping_, nullptr);
+#endif
+    }
+    return *this;
+}
@@ -0,0 +1,40 @@
+// ReSharper disable CppLocalVariableMayBeConst
+#include "menulayer.h"
+#include "game.h"
+#include "renderstats.h"
+
+MenuLayer::~MenuLayer() {
+    clear();
+}
+
+void MenuLayer::clear() {
+    if (texture_) {
+        SDL_DestroyTexture(texture_);
+        texture_ = nullptr;
+    }
+    valid_ = false;
+}
+
+bool MenuLayer::beginDrawing(SDL_Renderer* renderer) {
+    if (!texture_ && SDL_RenderTargetSupported(renderer)) {
+        texture_ = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, SCREEN_WIDTH, SCREEN_HEIGHT);
+        // Copied over the whole window as it is, like the screen had been drawn there directly
+        SDL_SetTextureBlendMode(texture_, SDL_BLENDMODE_NONE);
+    }
+    if (!texture_) {
+        return false;
+    }
+    previousTarget_ = SDL_GetRenderTarget(renderer);
+    SDL_SetRenderTarget(renderer, texture_);
+    return true;
+}
+
+void MenuLayer::endDrawing(SDL_Renderer* renderer) {
+    SDL_SetRenderTarget(renderer, previousTarget_);
+    valid_ = true;
+}
+
+void MenuLayer::copy(SDL_Renderer* renderer) const {
+    SDL_RenderCopy(renderer, texture_, nullptr, nullptr);
+    renderStats.draw(texture_);
+}
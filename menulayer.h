@@ -0,0 +1,43 @@
+#pragma once
+#include <SDL2/SDL.h>
+
+// The part of a menu screen that does not follow the mouse, drawn once into a window-sized target
+// texture. Redrawing the menu for a hover change then starts from a single copy of it.
+class MenuLayer {
+public:
+    MenuLayer() = default;
+    ~MenuLayer();
+
+    MenuLayer(const MenuLayer&) = delete;
+    MenuLayer& operator=(const MenuLayer&) = delete;
+
+    // Copies the layer to the window, first drawing it with draw() if it was invalidated since the
+    // last time. Without target textures draw() goes straight to the window on every call.
+    template<typename Draw>
+    void render(SDL_Renderer* renderer, Draw&& draw) {
+        if (!valid_) {
+            if (!beginDrawing(renderer)) {
+                draw();
+                return;
+            }
+            draw();
+            endDrawing(renderer);
+        }
+        copy(renderer);
+    }
+
+    // The next render draws the layer again, for when what the menu shows has changed
+    void invalidate() { valid_ = false; }
+    // Drops the texture, needed after SDL_RENDER_TARGETS_RESET lost its contents
+    void clear();
+
+private:
+    // Points the renderer at the texture, creating it first. False when that is not possible.
+    bool beginDrawing(SDL_Renderer* renderer);
+    void endDrawing(SDL_Renderer* renderer);
+    void copy(SDL_Renderer* renderer) const;
+
+    SDL_Texture* texture_ = nullptr;
+    SDL_Texture* previousTarget_ = nullptr;
+    bool valid_ = false;
+};
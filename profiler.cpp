@@ -0,0 +1,162 @@
+// ReSharper disable CppLocalVariableMayBeConst
+#include "profiler.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+
+using namespace std;
+
+namespace {
+
+constexpr size_t ringCapacity = 1 << 14; // zones kept per thread, a power of two
+constexpr uint64_t zoneWindowNs = 500'000'000;
+constexpr size_t zoneNames = 64; // distinct names endFrame has room for before it allocates
+
+uint64_t steadyNs() {
+    return static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+} // namespace
+
+// Written by its thread only. written is published with release after the event is stored, so a
+// reader that loads it with acquire sees every event below it. The writer does not wait for
+// readers: one that falls a whole ring behind has its oldest events overwritten under it, and
+// drops what written says may have changed while it copied.
+struct Profiler::Ring {
+    array<ProfileEvent, ringCapacity> events;
+    atomic<uint64_t> written = 0;
+    uint64_t collected = 0; // how far endFrame has read, main thread only
+    int id = 0;
+    string name;
+
+    // Copies the events in [max(from, written - capacity), written) to out and returns written
+    uint64_t snapshot(uint64_t from, vector<ProfileEvent>& out) const {
+        uint64_t end = written.load(memory_order_acquire);
+        uint64_t begin = max(from, end > ringCapacity ? end - ringCapacity : 0);
+        size_t start = out.size();
+        for (uint64_t i = begin; i < end; ++i) {
+            out.push_back(events[i % ringCapacity]);
+        }
+        // The writer may already be storing event `after`, over event after - capacity
+        uint64_t after = written.load(memory_order_acquire);
+        if (after + 1 > begin + ringCapacity) {
+            size_t overwritten = min<uint64_t>(after + 1 - ringCapacity - begin, end - begin);
+            out.erase(out.begin() + static_cast<ptrdiff_t>(start), out.begin() + static_cast<ptrdiff_t>(start + overwritten));
+        }
+        return end;
+    }
+};
+
+thread_local Profiler::Ring* Profiler::threadRing_ = nullptr;
+thread_local const char* Profiler::threadName_ = nullptr;
+
+Profiler::Profiler() : epoch_(steadyNs()) {
+    totals_.reserve(zoneNames);
+    zones_.reserve(zoneNames);
+}
+
+Profiler::~Profiler() = default;
+
+uint64_t Profiler::now() const {
+    return steadyNs() - epoch_;
+}
+
+Profiler::Ring& Profiler::ring() {
+    if (!threadRing_) {
+        lock_guard lock(ringsMutex_);
+        rings_.push_back(make_unique<Ring>());
+        threadRing_ = rings_.back().get();
+        threadRing_->id = static_cast<int>(rings_.size());
+        threadRing_->name = threadName_ ? threadName_ : "thread " + to_string(threadRing_->id);
+    }
+    return *threadRing_;
+}
+
+void Profiler::record(const char* name, uint64_t startNs, uint64_t endNs) {
+    Ring& r = ring();
+    uint64_t n = r.written.load(memory_order_relaxed);
+    r.events[n % ringCapacity] = { name, startNs, endNs };
+    r.written.store(n + 1, memory_order_release);
+}
+
+void Profiler::nameThread(const char* name) {
+    threadName_ = name; // for the ring, whenever the thread records its first zone
+    if (threadRing_) {
+        lock_guard lock(ringsMutex_); // writeTrace reads the names
+        threadRing_->name = name;
+    }
+}
+
+void Profiler::endFrame() {
+    uint64_t frameEnd = now();
+    frames_[nextFrame_] = static_cast<float>(frameEnd - lastFrameNs_) / 1e6f;
+    nextFrame_ = (nextFrame_ + 1) % frameHistory;
+    lastFrameNs_ = frameEnd;
+
+    // Reused, with room for a whole ring, so that a busy frame does not allocate either
+    static vector<ProfileEvent> collected = [] {
+        vector<ProfileEvent> events;
+        events.reserve(ringCapacity);
+        return events;
+    }();
+    collected.clear();
+    {
+        lock_guard lock(ringsMutex_);
+        for (auto& r : rings_) {
+            r->collected = r->snapshot(r->collected, collected);
+        }
+    }
+    for (const ProfileEvent& event : collected) {
+        auto it = ranges::find_if(totals_, [&](const ZoneTime& zone) { return strcmp(zone.name, event.name) == 0; });
+        if (it == totals_.end()) {
+            it = totals_.insert(totals_.end(), { event.name, 0 });
+        }
+        it->ms += static_cast<double>(event.endNs - event.startNs) / 1e6;
+    }
+
+    ++windowFrames_;
+    if (frameEnd - windowStartNs_ >= zoneWindowNs) {
+        zones_.clear();
+        for (ZoneTime& zone : totals_) {
+            zones_.push_back({ zone.name, zone.ms / windowFrames_ });
+            zone.ms = 0;
+        }
+        ranges::sort(zones_, [](const ZoneTime& a, const ZoneTime& b) { return a.ms > b.ms; });
+        windowStartNs_ = frameEnd;
+        windowFrames_ = 0;
+    }
+}
+
+bool Profiler::writeTrace(const string& path) const {
+    ofstream out(path);
+    if (!out) {
+        return false;
+    }
+    out << fixed;
+    out.precision(3); // microseconds down to the nanosecond
+    out << "{\"traceEvents\":[\n";
+    bool first = true;
+    auto separate = [&] {
+        out << (first ? "" : ",\n");
+        first = false;
+    };
+
+    lock_guard lock(ringsMutex_);
+    vector<ProfileEvent> events;
+    for (const auto& r : rings_) {
+        separate();
+        out << R"({"name":"thread_name","ph":"M","pid":1,"tid":)" << r->id << R"(,"args":{"name":")" << r->name << "\"}}";
+        events.clear();
+        r->snapshot(0, events);
+        for (const ProfileEvent& event : events) {
+            // Complete events, timestamps in microseconds
+            separate();
+            out << R"({"name":")" << event.name << R"(","ph":"X","pid":1,"tid":)" << r->id << ",\"ts\":" << static_cast<double>(event.startNs) / 1000
+                << ",\"dur\":" << static_cast<double>(event.endNs - event.startNs) / 1000 << "}";
+        }
+    }
+    out << "\n]}\n";
+    return static_cast<bool>(out);
+}
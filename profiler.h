@@ -0,0 +1,95 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// PROFILE_ZONE("name") times the rest of the enclosing scope. Zones are only compiled in when
+// the build defines MARIO_PROFILER (the CMake option of the same name), otherwise the macro
+// expands to nothing and the profiler never sees a zone.
+#ifdef MARIO_PROFILER
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCAT(profileZone, __LINE__)(name)
+#else
+#define PROFILE_ZONE(name) ((void)0)
+#endif
+
+// One finished zone. name has to outlive the profiler, zones are named with string literals.
+struct ProfileEvent {
+    const char* name;
+    uint64_t startNs; // since the profiler started
+    uint64_t endNs;
+};
+
+// Collects the zones every thread records. A thread writes into its own ring without locking,
+// the main thread reads all of them once a frame for the overlay and on request for a trace.
+class Profiler {
+public:
+    // Per-frame cost of one zone name, summed over every thread that ran it
+    struct ZoneTime {
+        const char* name;
+        double ms;
+    };
+
+    static constexpr size_t frameHistory = 240;
+
+    Profiler();
+    ~Profiler();
+
+    [[nodiscard]] uint64_t now() const;
+
+    // Adds a zone to the calling thread's ring, only its first one takes a lock
+    void record(const char* name, uint64_t startNs, uint64_t endNs);
+    // Shown for the calling thread in traces, instead of "thread N". Costs nothing until the thread records.
+    void nameThread(const char* name);
+
+    // Call from the main thread once per frame. Collects the zones recorded since the last call.
+    void endFrame();
+
+    // Milliseconds per frame of each zone over the last half second, the most expensive first
+    [[nodiscard]] const std::vector<ZoneTime>& zones() const { return zones_; }
+    // The length of each of the last frameHistory frames in ms, oldest first
+    [[nodiscard]] float frameMs(size_t i) const { return frames_[(nextFrame_ + i) % frameHistory]; }
+
+    // Writes every zone still in the rings as Chrome trace_event JSON, for chrome://tracing or Perfetto
+    bool writeTrace(const std::string& path) const;
+
+private:
+    struct Ring;
+
+    Ring& ring();
+
+    static thread_local Ring* threadRing_;
+    static thread_local const char* threadName_;
+
+    uint64_t epoch_;
+    mutable std::mutex ringsMutex_; // only guards the list, never the rings' contents
+    std::vector<std::unique_ptr<Ring>> rings_;
+
+    std::array<float, frameHistory> frames_{};
+    size_t nextFrame_ = 0;
+    uint64_t lastFrameNs_ = 0;
+    std::vector<ZoneTime> totals_; // summed since windowStartNs_
+    uint64_t windowStartNs_ = 0;
+    int windowFrames_ = 0;
+    std::vector<ZoneTime> zones_;
+};
+
+inline Profiler profiler;
+
+// Records the time from its construction to its destruction as a zone
+class ProfileZone {
+public:
+    explicit ProfileZone(const char* name) : name_(name), start_(profiler.now()) {}
+    ~ProfileZone() { profiler.record(name_, start_, profiler.now()); }
+
+    ProfileZone(const ProfileZone&) = delete;
+    ProfileZone& operator=(const ProfileZone&) = delete;
+
+private:
+    const char* name_;
+    uint64_t start_;
+};
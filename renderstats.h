@@ -0,0 +1,21 @@
+#pragma once
+#include <SDL2/SDL.h>
+
+// What the renderer was asked to do this frame. The main loop resets it before drawing and
+// shows the last frame's numbers in the stats overlay (F3).
+struct RenderStats {
+    int drawCalls = 0;
+    int textureSwitches = 0; // draw calls using a different texture than the one before
+    SDL_Texture* lastTexture = nullptr;
+
+    // Counts one draw call, texture is nullptr for untextured fills
+    void draw(SDL_Texture* texture) {
+        ++drawCalls;
+        if (texture != lastTexture) {
+            ++textureSwitches;
+            lastTexture = texture;
+        }
+    }
+};
+
+inline RenderStats renderStats;
@@ -0,0 +1,251 @@
+// ReSharper disable CppLocalVariableMayBeConst
+#include "replay.h"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+
+using namespace std;
+
+namespace {
+
+void writeVarint(string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+uint64_t readVarint(const string& in, size_t& pos) {
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (pos >= in.size()) {
+            throw runtime_error("Error: Truncated recording");
+        }
+        auto byte = static_cast<uint8_t>(in[pos++]);
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return value;
+        }
+    }
+    throw runtime_error("Error: Bad varint in recording");
+}
+
+// Keeps small negative values small
+uint64_t zigzag(int32_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(static_cast<int64_t>(value) >> 63);
+}
+
+int32_t unzigzag(uint64_t value) {
+    return static_cast<int32_t>((value >> 1) ^ (~(value & 1) + 1));
+}
+
+} // namespace
+
+void writeRecording(const Recording& recording, const string& path) {
+    RecordingHeader header = recording.header;
+    memcpy(header.magic, recordingMagic, sizeof(header.magic));
+    header.version = recordingVersion;
+    header.eventCount = static_cast<uint32_t>(recording.events.size());
+    header.tickCount = recording.hashes.size();
+    header.levelNameLength = static_cast<uint8_t>(min<size_t>(recording.levelName.size(), UINT8_MAX));
+
+    string events;
+    uint64_t lastTick = 0;
+    for (const InputEvent& event : recording.events) {
+        writeVarint(events, event.tick - lastTick);
+        events.push_back(static_cast<char>(event.type));
+        writeVarint(events, zigzag(event.value));
+        lastTick = event.tick;
+    }
+
+    ofstream out(path, ios::binary | ios::trunc);
+    if (!out) {
+        throw runtime_error("Error: Cannot write " + path);
+    }
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(recording.levelName.data(), header.levelNameLength);
+    out.write(events.data(), static_cast<streamsize>(events.size()));
+    out.write(reinterpret_cast<const char*>(recording.hashes.data()), static_cast<streamsize>(recording.hashes.size() * sizeof(uint32_t)));
+    if (!out) {
+        throw runtime_error("Error: Failed writing " + path);
+    }
+}
+
+Recording readRecording(const string& path) {
+    ifstream in(path, ios::binary);
+    if (!in) {
+        throw runtime_error("Error: Cannot open " + path);
+    }
+    string bytes((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+
+    Recording recording;
+    RecordingHeader& header = recording.header;
+    if (bytes.size() < sizeof(header)) {
+        throw runtime_error("Error: " + path + " is not a recording");
+    }
+    memcpy(&header, bytes.data(), sizeof(header));
+    if (memcmp(header.magic, recordingMagic, sizeof(header.magic)) != 0 || header.version != recordingVersion) {
+        throw runtime_error("Error: " + path + " is not a version " + to_string(recordingVersion) + " recording");
+    }
+    size_t pos = sizeof(header);
+    if (bytes.size() < pos + header.levelNameLength) {
+        throw runtime_error("Error: Truncated recording");
+    }
+    recording.levelName = bytes.substr(pos, header.levelNameLength);
+    pos += header.levelNameLength;
+
+    uint64_t tick = 0;
+    recording.events.reserve(header.eventCount);
+    for (uint32_t i = 0; i < header.eventCount; ++i) {
+        tick += readVarint(bytes, pos);
+        if (pos >= bytes.size()) {
+            throw runtime_error("Error: Truncated recording");
+        }
+        auto type = static_cast<InputEventType>(bytes[pos++]);
+        int32_t value = unzigzag(readVarint(bytes, pos));
+        recording.events.push_back({ tick, type, value });
+    }
+
+    if (bytes.size() - pos < header.tickCount * sizeof(uint32_t)) {
+        throw runtime_error("Error: Truncated recording");
+    }
+    recording.hashes.resize(header.tickCount);
+    memcpy(recording.hashes.data(), bytes.data() + pos, header.tickCount * sizeof(uint32_t));
+    return recording;
+}
+
+uint32_t hashSession(const GameSession& session) {
+    // FNV-1a over each field on its own, so struct padding never gets hashed
+    uint32_t hash = 2166136261u;
+    auto mix = [&hash](const auto& value) {
+        const auto* bytes = reinterpret_cast<const uint8_t*>(&value);
+        for (size_t i = 0; i < sizeof(value); ++i) {
+            hash = (hash ^ bytes[i]) * 16777619u;
+        }
+    };
+    const GameObject& player = session.level.player;
+    mix(session.ticks);
+    mix(session.state);
+    mix(session.currentLevelIndex);
+    mix(session.lives);
+    mix(session.collectedCoins);
+    mix(player.rect.x);
+    mix(player.rect.y);
+    mix(session.gravity);
+    mix(session.isOnGround);
+    mix(session.jumped);
+    mix(session.canDoubleJump);
+    mix(session.level.removedTiles.size());
+    mix(session.level.enemies.size());
+    const EnemySet& enemies = session.level.enemies;
+    for (size_t i = 0; i < enemies.size(); ++i) {
+        mix(enemies.rect(i).x);
+        mix(enemies.movingRight(i));
+    }
+    return hash;
+}
+
+bool applyInput(GameSession& session, const InputEvent& event) {
+    switch (event.type) {
+    case INPUT_KEY:
+        session.keyDown(event.value);
+        return false;
+    case INPUT_NEXT_LEVEL:
+        return session.nextLevel();
+    case INPUT_RETRY:
+        return session.retry();
+    default:
+        return false;
+    }
+}
+
+void InputRecorder::begin(const GameSession& session, int levelIndex) {
+    if (path_.empty()) {
+        return;
+    }
+    if (active_) {
+        finish();
+    }
+    recording_ = Recording();
+    RecordingHeader& header = recording_.header;
+    header.tickRate = TICK_RATE;
+    header.startTick = session.ticks;
+    header.lives = session.lives;
+    header.character = session.playerChar;
+    header.gameMode = session.gameMode;
+    header.noMoreLives = session.noMoreLives;
+    recording_.levelName = filesystem::path(session.levelFiles[levelIndex]).filename().string();
+    active_ = true;
+}
+
+bool InputRecorder::apply(GameSession& session, InputEventType type, int32_t value) {
+    InputEvent event = { session.ticks - recording_.header.startTick, type, value };
+    if (active_) {
+        recording_.events.push_back(event);
+    }
+    return applyInput(session, event);
+}
+
+void InputRecorder::tick(const GameSession& session) {
+    if (active_) {
+        recording_.hashes.push_back(hashSession(session));
+    }
+}
+
+void InputRecorder::finish() {
+    if (!active_) {
+        return;
+    }
+    active_ = false;
+    try {
+        writeRecording(recording_, path_);
+        cout << "Recorded " << recording_.hashes.size() << " ticks and " << recording_.events.size() << " inputs to " << path_ << endl;
+    } catch (const exception& e) {
+        cerr << e.what() << endl;
+    }
+}
+
+void InputReplayer::begin(GameSession& session) {
+    const RecordingHeader& header = recording_.header;
+    if (header.tickRate != TICK_RATE) {
+        throw runtime_error("Error: Recorded at " + to_string(header.tickRate) + " ticks per second, this build runs " + to_string(TICK_RATE));
+    }
+    int levelIndex = -1;
+    for (size_t i = 0; i < session.levelFiles.size(); ++i) {
+        if (filesystem::path(session.levelFiles[i]).filename().string() == recording_.levelName) {
+            levelIndex = static_cast<int>(i);
+        }
+    }
+    if (levelIndex < 0) {
+        throw runtime_error("Error: The recording starts on " + recording_.levelName + ", which is not in the levels folder");
+    }
+
+    session.ticks = header.startTick;
+    session.lives = header.lives;
+    session.playerChar = static_cast<Character>(header.character);
+    session.gameMode = static_cast<GameMode>(header.gameMode);
+    session.noMoreLives = header.noMoreLives;
+    session.startLevel(levelIndex);
+    next_ = 0;
+    ticks_ = 0;
+    divergedAt_ = -1;
+}
+
+bool InputReplayer::beforeTick(GameSession& session) {
+    bool changeBackground = false;
+    for (; next_ < recording_.events.size() && recording_.events[next_].tick == ticks_; ++next_) {
+        changeBackground |= applyInput(session, recording_.events[next_]);
+    }
+    return changeBackground;
+}
+
+void InputReplayer::afterTick(const GameSession& session) {
+    if (divergedAt_ < 0 && ticks_ < recording_.hashes.size() && hashSession(session) != recording_.hashes[ticks_]) {
+        divergedAt_ = static_cast<int64_t>(ticks_);
+    }
+    ++ticks_;
+}
@@ -0,0 +1,107 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "session.h"
+
+// Input recording (.mrec) layout:
+//   RecordingHeader
+//   char levelName[levelNameLength]     file name of the level the run started on
+//   eventCount events, each: varint tick delta, uint8_t InputEventType, zigzag varint value
+//   uint32_t hashes[tickCount]          hashSession after every tick
+// Ticks count from the start of the run. Like the compiled levels, the header is in host byte order.
+
+constexpr char recordingMagic[4] = { 'M', 'R', 'E', 'C' };
+constexpr uint32_t recordingVersion = 3; // 2: enemies are hashed in SlotMap order, 3: the player moves by swept collision
+
+struct RecordingHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t tickRate; // TICK_RATE of the build that recorded it, a replay needs the same one
+    uint32_t eventCount;
+    uint64_t startTick; // GameSession::ticks when the run started, the session's timers depend on it
+    uint64_t tickCount;
+    int32_t lives;
+    uint8_t character;
+    uint8_t gameMode;
+    uint8_t noMoreLives;
+    uint8_t levelNameLength;
+    uint64_t reserved;
+};
+static_assert(sizeof(RecordingHeader) == 48);
+
+enum InputEventType : uint8_t {
+    INPUT_KEY,
+    INPUT_NEXT_LEVEL,
+    INPUT_RETRY
+};
+
+struct InputEvent {
+    uint64_t tick; // applied once this many ticks of the run had passed
+    InputEventType type;
+    int32_t value; // the SDL_Keycode of an INPUT_KEY
+};
+
+// One run of the game, from a level started in the menus until the player is back in them
+struct Recording {
+    RecordingHeader header{};
+    std::string levelName;
+    std::vector<InputEvent> events;
+    std::vector<uint32_t> hashes;
+};
+
+// Throws runtime_error when the file can't be written or read, or is not a recording
+void writeRecording(const Recording& recording, const std::string& path);
+Recording readRecording(const std::string& path);
+
+// Everything the simulation decides, but none of the textures or sounds
+uint32_t hashSession(const GameSession& session);
+
+// Hands event to the session. Returns what nextLevel or retry returned, whether the background has to change.
+bool applyInput(GameSession& session, const InputEvent& event);
+
+// Records every run of a session to path, each run replacing the one before. Does nothing when path is empty.
+class InputRecorder {
+public:
+    explicit InputRecorder(std::string path) : path_(std::move(path)) {}
+
+    [[nodiscard]] bool active() const { return active_; }
+
+    // Starts a run, call right before session.startLevel(levelIndex)
+    void begin(const GameSession& session, int levelIndex);
+    // Records event and applies it to session
+    bool apply(GameSession& session, InputEventType type, int32_t value);
+    // Call after every session.tick()
+    void tick(const GameSession& session);
+    // Writes the run out, reporting errors instead of throwing
+    void finish();
+
+private:
+    std::string path_;
+    Recording recording_;
+    bool active_ = false;
+};
+
+// Plays a recording back into a session through the same calls the game makes for real input,
+// checking the session's hash after every tick.
+class InputReplayer {
+public:
+    explicit InputReplayer(Recording recording) : recording_(std::move(recording)) {}
+
+    // Puts session where the recorded run started and starts its level. session.levelFiles must be set.
+    void begin(GameSession& session);
+    // Applies the inputs due before the next tick. Returns true if the background has to change.
+    bool beforeTick(GameSession& session);
+    void afterTick(const GameSession& session);
+
+    [[nodiscard]] bool finished() const { return ticks_ >= recording_.hashes.size(); }
+    [[nodiscard]] uint64_t ticks() const { return ticks_; }
+    // The first tick whose hash did not match the recording, -1 while they all have
+    [[nodiscard]] int64_t divergedAt() const { return divergedAt_; }
+
+private:
+    Recording recording_;
+    size_t next_ = 0;
+    uint64_t ticks_ = 0;
+    int64_t divergedAt_ = -1;
+};
@@ -0,0 +1,335 @@
+// ReSharper disable CppParameterMayBeConst
+// ReSharper disable CppLocalVariableMayBeConst
+#include "session.h"
+#include "profiler.h"
+
+using namespace std;
+
+namespace {
+
+constexpr Sint32 levelTimeLimit = 100000;
+constexpr float fadeDuration = 2000;
+constexpr size_t audioCueCapacity = 32; // more than a frame queues, so queueing one never allocates
+
+} // namespace
+
+GameSession::GameSession() {
+    audio.reserve(audioCueCapacity);
+}
+
+Sint32 GameSession::remainingSeconds() const {
+    Sint32 elapsed = now() - levelStartTime;
+    return levelTimeLimit > elapsed ? (levelTimeLimit - elapsed) / 1000 : 0;
+}
+
+float GameSession::fadeProgress() const {
+    Sint32 start = state == DYING ? dyingStartTime : transitionStartTime;
+    return min(static_cast<float>(now() - start) / fadeDuration, 1.0f);
+}
+
+void GameSession::load(int index) {
+    currentLevelIndex = index;
+    collectedCoins = 0;
+    levelLoader.take(levelFiles[currentLevelIndex], level, sprites, playerSprites);
+    totalCoins = level.totalCoins;
+    previousPlayerRect = level.player.rect;
+    levelStartTime = now();
+    state = PLAYING;
+}
+
+void GameSession::startLevel(int index) {
+    // A run started from the menus begins standing still, whatever the last one was doing
+    isOnGround = true;
+    canDoubleJump = false;
+    jumped = false;
+    isWalkingLeft = false;
+    gravity = FALL_SPEED;
+    lastJumpTime = 0;
+    lastStepTime = 0;
+    load(index);
+}
+
+bool GameSession::nextLevel() {
+    if (soundPlayed) {
+        audio.push_back(CUE_HALT_SOUNDS);
+    }
+    if (currentLevelIndex + 1 >= static_cast<int>(levelFiles.size())) {
+        ++currentLevelIndex;
+        isLastLevel = true;
+        state = WON;
+        return false;
+    }
+    load(currentLevelIndex + 1);
+    audio.push_back(CUE_RESUME_MUSIC);
+    musicPlaying = true;
+    soundPlayed = false;
+    return true;
+}
+
+bool GameSession::retry() {
+    bool restarted = noMoreLives;
+    load(retryLevelIndex());
+    audio.push_back(CUE_RESUME_MUSIC);
+    musicPlaying = true;
+    soundPlayed = false;
+    return restarted;
+}
+
+void GameSession::die(DeathReason reason) {
+    if (musicPlaying) {
+        audio.push_back(CUE_PAUSE_MUSIC);
+        audio.push_back(CUE_LOST);
+        musicPlaying = false;
+    }
+    dyingStartTime = now();
+    level.player.sprite = playerSprites[4];
+    deathReason = reason;
+    state = DYING;
+}
+
+void GameSession::keyDown(SDL_Keycode key) {
+    PROFILE_ZONE("input");
+    Sint32 currentTime = now();
+    GameObject& player = level.player;
+
+    if (key == SDLK_m) {
+        audio.push_back(musicPlaying ? CUE_PAUSE_MUSIC : CUE_RESUME_MUSIC);
+        musicPlaying = !musicPlaying;
+    }
+    if (state == START_SCREEN) {
+        if (key == SDLK_ESCAPE) {
+            quit = true;
+        }
+    } else if (state == SETTINGS || state == MODE_SELECT) {
+        if (key == SDLK_ESCAPE) {
+            state = START_SCREEN;
+        }
+    } else if (state == LEVEL_SELECT) {
+        if (key == SDLK_ESCAPE) {
+            state = MODE_SELECT;
+        }
+    } else if (state == ABOUT) {
+        if (key == SDLK_ESCAPE) {
+            state = SETTINGS;
+        }
+    } else if ((state == WON || state == LOST) && key == SDLK_SPACE) {
+        // ReSharper disable once CppExpressionWithoutSideEffects
+        // ReSharper disable once CppDFAConstantConditions
+        state == START_SCREEN;
+    } else if (state == DYING) {
+        if (key == SDLK_SPACE) {
+            state = LOST;
+        }
+    } else if (state == PLAYING) {
+        Sint32 stepCooldown = 685.877;
+        SDL_FRect newRect = player.rect;
+        float moveSpeed = TILE_SIZE;
+
+        switch (key) {
+        case SDLK_SPACE:
+            if (isOnGround) {
+                if (isWalkingLeft) {
+                    player.sprite = playerSprites[5];
+                } else {
+                    player.sprite = playerSprites[6];
+                }
+                audio.push_back(CUE_JUMP);
+                gravity = JUMP_FALL_SPEED;
+                isOnGround = false;
+                jumped = true;
+                canDoubleJump = true;
+                newRect.y -= moveSpeed; // first jump
+                lastJumpTime = currentTime;
+            } else if (canDoubleJump && (currentTime - lastJumpTime) < 500) {
+                audio.push_back(CUE_JUMP);
+                newRect.y -= moveSpeed;  // Double jump
+                jumped = true;
+                canDoubleJump = false;
+            }
+            break;
+        case SDLK_w:
+            if (hasIntersection(player.rect, level.door.rect) && collectedCoins == totalCoins) {
+                state = TRANSITION;
+                transitionStartTime = currentTime;
+                level.door.sprite = sprites[6];
+            } else { newRect.y -= moveSpeed; }
+            break;
+        case SDLK_s:
+            newRect.y += moveSpeed;
+            break;
+        case SDLK_a:
+            newRect.x -= moveSpeed;
+            player.sprite = playerSprites[2];
+            if (currentTime - lastStepTime > stepCooldown) {
+                audio.push_back(CUE_STEP);
+                lastStepTime = currentTime;
+            }
+            isWalkingLeft = true;
+            break;
+        case SDLK_d:
+            newRect.x += moveSpeed;
+            player.sprite = playerSprites[3];
+            if (currentTime - lastStepTime > stepCooldown) {
+                audio.push_back(CUE_STEP);
+                lastStepTime = currentTime;
+            }
+            isWalkingLeft = false;
+            break;
+        case SDLK_p:
+            collectedCoins = totalCoins;
+            break;
+        case SDLK_o:
+            collectedCoins = totalCoins;
+            isLastLevel = true;
+            state = WON;
+            break;
+        case SDLK_l:
+            if (musicPlaying) {
+                audio.push_back(CUE_HALT_MUSIC);
+                audio.push_back(CUE_LOST);
+                musicPlaying = false;
+            }
+            dyingStartTime = currentTime;
+            player.sprite = playerSprites[4];
+            state = DYING;
+            break;
+        case SDLK_ESCAPE:
+            state = START_SCREEN;
+            break;
+        default: break;
+        }
+
+        // Ensure the player does not go out of the level's bounds
+        if (newRect.x < 0) newRect.x = 0;
+        if (newRect.x + newRect.w > level.width()) newRect.x = level.width() - newRect.w;
+        if (newRect.y < 0) newRect.y = 0;
+        if (newRect.y + newRect.h > level.height()) newRect.y = level.height() - newRect.h;
+
+        // Move as far as the bricks allow, then pick up whatever the player passed over on the way
+        SDL_FRect start = player.rect;
+        moveAndSlide(level, player.rect, newRect.x - start.x, newRect.y - start.y);
+        SDL_FRect passed = { min(start.x, player.rect.x), min(start.y, player.rect.y), fabs(player.rect.x - start.x) + start.w, fabs(player.rect.y - start.y) + start.h };
+        level.any(passed, [&](Chunk& chunk, int32_t i) {
+            const GameObject& obj = chunk.gameObjects[i];
+            if ((obj.kind == OBJECT_COIN || obj.kind == OBJECT_LIFE) && hasIntersection(passed, obj.rect)) {
+                if (obj.kind == OBJECT_COIN) {
+                    ++collectedCoins;
+                } else {
+                    ++lives;
+                }
+                removeGameObject(level, chunk, i);
+                audio.push_back(CUE_COIN);
+            }
+            return false;
+        });
+    }
+}
+
+void GameSession::tick() {
+    PROFILE_ZONE("tick");
+    ++ticks;
+    if (state != previousState) {
+        // The fades last two seconds, long enough to parse whichever level the player goes to next
+        if (state == TRANSITION && currentLevelIndex + 1 < static_cast<int>(levelFiles.size())) {
+            levelLoader.prefetch(levelFiles[currentLevelIndex + 1], sprites, playerSprites);
+        } else if (state == DYING) {
+            levelLoader.prefetch(levelFiles[retryLevelIndex()], sprites, playerSprites);
+        }
+        previousState = state;
+    }
+
+    if (state == PLAYING) {
+        tickPlaying();
+    } else if (state == DYING) {
+        tickDying();
+    } else if (state == TRANSITION) {
+        tickTransition();
+    } else if (state == WON && gameMode == CUSTOM) {
+        isLastLevel = false;
+    }
+}
+
+void GameSession::tickPlaying() {
+    Sint32 currentTime = now();
+    GameObject& player = level.player;
+    previousPlayerRect = player.rect;
+
+    if (currentTime - levelStartTime > levelTimeLimit) {
+        die(DEATH_TIME);
+        return;
+    }
+
+    if (level.enemies.anyOverlapping(player.rect, workers)) {
+        die(DEATH_ENEMY);
+    }
+    {
+        PROFILE_ZONE("player physics");
+        if (jumped && isOnPlatform(player, level)) { // bs fix for jumping
+            isOnGround = true;
+            gravity = LANDED_FALL_SPEED;
+            jumped = false;
+            player.sprite = isWalkingLeft ? playerSprites[0] : playerSprites[1];
+        }
+        if (!isOnPlatform(player, level) && !isOnVine(player, level)) { // apply gravity
+            if (!isAtTopOfVine(player, level)) {
+                if (currentTime - lastJumpTime > 500) {
+                    gravity = FALL_SPEED;
+                }
+                moveAndSlide(level, player.rect, 0, gravity * TICK_SECONDS);
+                if (player.rect.y + player.rect.h > level.height()) { // imagine falling off the level :')
+                    player.rect.y = level.height() - player.rect.h;
+                }
+            }
+        }
+
+        // Falling into the last tile row is a death
+        if (player.rect.y >= level.height() - TILE_SIZE) {
+            die(DEATH_FALL);
+        }
+    }
+
+    // Landing on an enemy's head kills it, one per tick
+    if (size_t stomped = level.enemies.update(player.rect, TICK_SECONDS, workers); stomped != EnemySet::npos) {
+        audio.push_back(CUE_KILL);
+        level.enemies.removeAt(stomped);
+    }
+    PROFILE_ZONE("stream chunks");
+    streamChunks(level, cameraView(level, player));
+}
+
+void GameSession::tickDying() {
+    float progress = fadeProgress();
+    previousPlayerRect = level.player.rect;
+    if (progress >= 1.0f) {
+        state = LOST;
+        --lives;
+        if (outOfLives(lives)) {
+            noMoreLives = true;
+            deathReason = DEATH_LIVES;
+        }
+    } else if (progress >= 0.2f && progress < 0.5f) {
+        level.player.rect.y -= 20 * TICK_SECONDS; // Move the player up
+    } else if (progress > 0.5f) {
+        level.player.rect.y += 90 * TICK_SECONDS; // Move the player down faster
+    }
+}
+
+void GameSession::tickTransition() {
+    if (fadeProgress() >= 1.0f) {
+        state = WON;
+        return;
+    }
+    if (currentLevelIndex >= static_cast<int>(levelFiles.size()) - 1) {
+        isLastLevel = true;
+        if (!soundPlayed) {
+            audio.push_back(CUE_PAUSE_MUSIC);
+            audio.push_back(CUE_CLEAR);
+            soundPlayed = true;
+        }
+    }
+    if (!soundPlayed) {
+        audio.push_back(CUE_PAUSE_MUSIC);
+        audio.push_back(CUE_WON);
+        soundPlayed = true;
+    }
+}
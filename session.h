@@ -0,0 +1,138 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "level.h"
+#include "levelloader.h"
+
+enum Character {
+    mario,
+    luigi,
+    none
+};
+
+enum GameState {
+    START_SCREEN,
+    SETTINGS,
+    ABOUT,
+    LEVEL_SELECT,
+    PLAYING,
+    TRANSITION,
+    WON,
+    DYING,
+    LOST,
+    MODE_SELECT
+};
+
+// Why the player is on the lost screen
+enum DeathReason {
+    DEATH_NONE,
+    DEATH_TIME,
+    DEATH_ENEMY,
+    DEATH_FALL,
+    DEATH_LIVES // out of lives, whatever took the last one
+};
+
+enum GameMode {
+    NORMAL,
+    CUSTOM
+};
+
+// Sounds and music changes the session asks for, played by whoever owns the mixer. The sound
+// cues are in the same order as main's sounds vector.
+enum AudioCue {
+    CUE_LOST,
+    CUE_COIN,
+    CUE_CLEAR,
+    CUE_WON,
+    CUE_JUMP,
+    CUE_KILL,
+    CUE_STEP,
+    CUE_PAUSE_MUSIC,
+    CUE_RESUME_MUSIC,
+    CUE_HALT_MUSIC,
+    CUE_HALT_SOUNDS
+};
+
+// The gameplay state machine with everything it owns: the level, lives, coins and timers.
+// It never touches a renderer, the mixer or a font, so it steps the same with or without a
+// window. Time only moves in tick(), TICK_RATE ticks per simulated second.
+struct GameSession {
+    GameState state = START_SCREEN;
+    GameMode gameMode = NORMAL;
+    Character playerChar = mario;
+
+    std::vector<std::string> levelFiles;
+    SDL_Texture* background = nullptr; // changes with the level
+    // brick, vine, coin, enemy left/right, door closed/open, life
+    std::vector<const Sprite*> sprites;
+    // left, right, walking left/right, lost, jumping left/right
+    std::vector<const Sprite*> playerSprites;
+
+    Level level;
+    LevelLoader levelLoader;
+    ThreadPool* workers = nullptr; // splits the enemy updates of big levels, see EnemySet::update
+    int currentLevelIndex = 0;
+    int lives = 3;
+    int totalCoins = 0;
+    int collectedCoins = 0;
+    bool isLastLevel = false;
+    bool noMoreLives = false;
+    bool musicPlaying = true;
+    bool quit = false;
+    DeathReason deathReason = DEATH_NONE;
+
+    SDL_FRect previousPlayerRect{}; // player.rect before the last tick, for interpolated rendering
+    std::vector<AudioCue> audio; // cues since the owner last cleared it
+
+    uint64_t ticks = 0;
+    Sint32 levelStartTime = 0;
+    Sint32 lastJumpTime = 0;
+    Sint32 lastStepTime = 0;
+    Sint32 dyingStartTime = 0;
+    Sint32 transitionStartTime = 0;
+    bool isOnGround = true;
+    bool canDoubleJump = false;
+    bool jumped = false;
+    bool isWalkingLeft = false;
+    bool soundPlayed = false;
+    float gravity = FALL_SPEED;
+
+    GameSession();
+
+    // Milliseconds of simulated time
+    [[nodiscard]] Sint32 now() const { return static_cast<Sint32>(ticks * 1000 / TICK_RATE); }
+    [[nodiscard]] Sint32 remainingSeconds() const;
+    // How far the transition or dying fade is, from 0 to 1
+    [[nodiscard]] float fadeProgress() const;
+
+    [[nodiscard]] bool inMenus() const {
+        return state == START_SCREEN || state == SETTINGS || state == ABOUT || state == LEVEL_SELECT || state == MODE_SELECT;
+    }
+
+    void keyDown(SDL_Keycode key);
+    void tick();
+
+    // The actions behind the menu buttons
+    void startLevel(int index);
+    // Returns false when there was no next level and the game is won instead
+    bool nextLevel();
+    // Returns true when out of lives and sent back to the first level
+    bool retry();
+
+private:
+    void die(DeathReason reason);
+    void tickPlaying();
+    void tickDying();
+    void tickTransition();
+    void load(int index);
+    // Whether a session with this many lives left is over
+    static bool outOfLives(int livesLeft) { return livesLeft <= 0; }
+    // The level retry() loads after the current death. While DYING the death has not cost its
+    // life yet, so this gives the same answer before and after tickDying() counts it.
+    [[nodiscard]] int retryLevelIndex() const {
+        bool gameOver = noMoreLives || (state == DYING && outOfLives(lives - 1));
+        return gameOver ? 0 : currentLevelIndex;
+    }
+
+    GameState previousState = START_SCREEN;
+};
@@ -0,0 +1,43 @@
+#include "simd.h"
+#include <algorithm>
+
+using namespace std;
+
+namespace {
+
+SimdLevel detectSimdLevel() {
+#ifdef SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return SIMD_AVX2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return SIMD_SSE2;
+    }
+#endif
+    return SIMD_SCALAR;
+}
+
+const SimdLevel supportedLevel = detectSimdLevel();
+SimdLevel activeLevel = supportedLevel;
+
+} // namespace
+
+SimdLevel simdLevel() {
+    return activeLevel;
+}
+
+void setSimdLevel(SimdLevel level) {
+    activeLevel = min(level, supportedLevel);
+}
+
+const char* simdLevelName(SimdLevel level) {
+    switch (level) {
+    case SIMD_AVX2:
+        return "avx2";
+    case SIMD_SSE2:
+        return "sse2";
+    default:
+        return "scalar";
+    }
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+// The instruction sets the vector kernels (enemies, batched AABB tests) are written for. The best
+// one the CPU has is used unless a benchmark picks another.
+enum SimdLevel {
+    SIMD_SCALAR,
+    SIMD_SSE2,
+    SIMD_AVX2
+};
+
+SimdLevel simdLevel();
+// level is clamped to what the CPU has
+void setSimdLevel(SimdLevel level);
+const char* simdLevelName(SimdLevel level);
+
+// Kernels for x86 are compiled with per-function target attributes, so the build needs no -m flags
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define SIMD_X86 1
+#endif
@@ -0,0 +1,95 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "arena.h"
+
+// Stable handles for values a container keeps densely, in no particular order, in one or more
+// arrays of its own. Removing a value moves the last one into its place, O(1), and the container
+// moves its array elements the same way. A Handle names one value for as long as it lives: every
+// removal bumps its slot's generation, so handles to removed values stop resolving even after the
+// slot is reused.
+class SlotIndex {
+public:
+    struct Handle {
+        uint32_t slot = UINT32_MAX;
+        uint32_t generation = 0;
+        bool operator==(const Handle&) const = default;
+    };
+
+    static constexpr size_t npos = SIZE_MAX;
+
+    // Keeps its arrays in arena, or on the heap without one
+    explicit SlotIndex(Arena* arena = nullptr) : valueSlots_(ArenaAllocator<uint32_t>(arena)), slots_(ArenaAllocator<Slot>(arena)) {}
+
+    // The handle of a value the container appends at position size()
+    Handle add() {
+        uint32_t slot;
+        if (freeHead_ != UINT32_MAX) {
+            slot = freeHead_;
+            freeHead_ = slots_[slot].position;
+        } else {
+            slot = static_cast<uint32_t>(slots_.size());
+            slots_.push_back({ 0, 0 });
+        }
+        slots_[slot].position = static_cast<uint32_t>(valueSlots_.size());
+        valueSlots_.push_back(slot);
+        return { slot, slots_[slot].generation };
+    }
+
+    // Forgets the value at position, after which the last value's handle refers to position.
+    // The container has to move its last value there too.
+    void removeAt(size_t position) {
+        uint32_t slot = valueSlots_[position];
+        if (position != valueSlots_.size() - 1) {
+            valueSlots_[position] = valueSlots_.back();
+            slots_[valueSlots_[position]].position = static_cast<uint32_t>(position);
+        }
+        valueSlots_.pop_back();
+        free(slot);
+    }
+
+    // The position of handle's value, npos once it was removed
+    [[nodiscard]] size_t find(Handle handle) const {
+        if (handle.slot >= slots_.size() || slots_[handle.slot].generation != handle.generation) {
+            return npos;
+        }
+        return slots_[handle.slot].position;
+    }
+
+    [[nodiscard]] Handle handleAt(size_t position) const {
+        uint32_t slot = valueSlots_[position];
+        return { slot, slots_[slot].generation };
+    }
+
+    // Forgets every value, no handle handed out so far resolves afterwards
+    void clear() {
+        for (uint32_t slot : valueSlots_) {
+            free(slot);
+        }
+        valueSlots_.clear();
+    }
+
+    void reserve(size_t count) {
+        valueSlots_.reserve(count);
+        slots_.reserve(count);
+    }
+
+    [[nodiscard]] size_t size() const { return valueSlots_.size(); }
+
+private:
+    struct Slot {
+        uint32_t position; // of the value, or the next free slot while this one is free
+        uint32_t generation;
+    };
+
+    void free(uint32_t slot) {
+        ++slots_[slot].generation;
+        slots_[slot].position = freeHead_;
+        freeHead_ = slot;
+    }
+
+    ArenaVector<uint32_t> valueSlots_; // the slot of each value
+    ArenaVector<Slot> slots_;
+    uint32_t freeHead_ = UINT32_MAX;
+};
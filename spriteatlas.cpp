@@ -0,0 +1,212 @@
+// ReSharper disable CppLocalVariableMayBeConst
+#include "spriteatlas.h"
+#include <algorithm>
+#include <iostream>
+#include "renderstats.h"
+
+using namespace std;
+
+namespace {
+
+constexpr int maxPageSize = 2048;
+constexpr int spritePadding = 1; // keeps filtering from bleeding one sprite into the next
+
+struct Placement {
+    SDL_Surface* pixels;
+    Sprite* sprite;
+    int page;
+    SDL_Rect rect;
+};
+
+int pageSizeFor(SDL_Renderer* renderer) {
+    int pageSize = maxPageSize;
+    SDL_RendererInfo info;
+    if (SDL_GetRendererInfo(renderer, &info) == 0 && info.max_texture_width > 0 && info.max_texture_height > 0) {
+        pageSize = min({ pageSize, info.max_texture_width, info.max_texture_height });
+    }
+    return pageSize;
+}
+
+// Makes pixels the whole of a texture of the sprite's own, freeing them
+bool uploadAlone(SDL_Renderer* renderer, Sprite& sprite, SDL_Surface* pixels) {
+    sprite.texture = SDL_CreateTextureFromSurface(renderer, pixels);
+    sprite.rect = { 0, 0, pixels->w, pixels->h };
+    sprite.uv = { 0, 0, 1, 1 };
+    SDL_FreeSurface(pixels);
+    return sprite.texture != nullptr;
+}
+
+} // namespace
+
+void renderSprite(SDL_Renderer* renderer, const Sprite& sprite, const SDL_FRect& dest) {
+    SDL_RenderCopyF(renderer, sprite.texture, &sprite.rect, &dest);
+    renderStats.draw(sprite.texture);
+}
+
+SpriteAtlas::~SpriteAtlas() {
+    destroy();
+}
+
+const Sprite* SpriteAtlas::add(SDL_Renderer* renderer, SDL_Surface* pixels) {
+    auto entry = make_unique<Entry>(Entry{ {}, pixels, -1 });
+    int pageSize = pageSizeFor(renderer);
+    if (pixels->w > pageSize || pixels->h > pageSize) {
+        entry->pixels = nullptr;
+        if (!uploadAlone(renderer, entry->sprite, pixels)) {
+            return nullptr;
+        }
+    }
+    const Sprite* sprite = &entry->sprite;
+    entries_.emplace(sprite, std::move(entry));
+    return sprite;
+}
+
+void SpriteAtlas::unload(const Sprite* sprite) {
+    auto it = entries_.find(sprite);
+    if (it == entries_.end()) {
+        return;
+    }
+    Entry& entry = *it->second;
+    if (entry.pixels) {
+        SDL_FreeSurface(entry.pixels);
+    } else if (entry.page < 0) {
+        SDL_DestroyTexture(entry.sprite.texture);
+    } else if (Page& page = pages_[entry.page]; --page.sprites == 0) {
+        SDL_DestroyTexture(page.texture);
+        page.texture = nullptr;
+    }
+    entries_.erase(it);
+}
+
+void SpriteAtlas::destroy() {
+    while (!entries_.empty()) {
+        unload(entries_.begin()->first);
+    }
+    pages_.clear();
+}
+
+size_t SpriteAtlas::pageCount() const {
+    return ranges::count_if(pages_, [](const Page& page) { return page.texture != nullptr; });
+}
+
+bool SpriteAtlas::pack(SDL_Renderer* renderer) {
+    int pageSize = pageSizeFor(renderer);
+
+    // Shelf packing, tallest first so each shelf wastes little above its shorter sprites
+    vector<Placement> placements;
+    for (auto& [key, entry] : entries_) {
+        if (entry->pixels) {
+            placements.push_back({ entry->pixels, &entry->sprite, 0, { 0, 0, entry->pixels->w, entry->pixels->h } });
+            entry->pixels = nullptr;
+        }
+    }
+    ranges::sort(placements, [](const Placement& a, const Placement& b) { return a.rect.h > b.rect.h; });
+
+    vector<SDL_Point> pageSizes;
+    int page = 0;
+    int x = 0;
+    int y = 0;
+    int shelfHeight = 0;
+    for (Placement& placement : placements) {
+        if (x + placement.rect.w > pageSize) {
+            x = 0;
+            y += shelfHeight + spritePadding;
+            shelfHeight = 0;
+        }
+        if (y + placement.rect.h > pageSize) {
+            ++page;
+            x = 0;
+            y = 0;
+            shelfHeight = 0;
+        }
+        if (page >= static_cast<int>(pageSizes.size())) {
+            pageSizes.push_back({ 0, 0 });
+        }
+        placement.page = page;
+        placement.rect.x = x;
+        placement.rect.y = y;
+        x += placement.rect.w + spritePadding;
+        shelfHeight = max(shelfHeight, placement.rect.h);
+        pageSizes[page].x = max(pageSizes[page].x, placement.rect.x + placement.rect.w);
+        pageSizes[page].y = max(pageSizes[page].y, placement.rect.y + placement.rect.h);
+    }
+
+    bool packed = true;
+    for (size_t i = 0; i < pageSizes.size(); ++i) {
+        SDL_Texture* texture = nullptr;
+        SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormat(0, pageSizes[i].x, pageSizes[i].y, 32, SDL_PIXELFORMAT_RGBA32);
+        if (surface) {
+            SDL_FillRect(surface, nullptr, 0);
+            for (Placement& placement : placements) {
+                if (placement.page == static_cast<int>(i)) {
+                    // Copy the sprite's alpha as it is instead of blending it onto the empty page
+                    SDL_SetSurfaceBlendMode(placement.pixels, SDL_BLENDMODE_NONE);
+                    SDL_BlitSurface(placement.pixels, nullptr, surface, &placement.rect);
+                }
+            }
+            texture = SDL_CreateTextureFromSurface(renderer, surface);
+            SDL_FreeSurface(surface);
+        }
+        if (texture) {
+            SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+        } else {
+            cerr << "Failed to create sprite atlas page " << i << ", its sprites get textures of their own: " << SDL_GetError() << endl;
+            packed = false;
+        }
+
+        auto width = static_cast<float>(pageSizes[i].x);
+        auto height = static_cast<float>(pageSizes[i].y);
+        int pageIndex = static_cast<int>(pages_.size());
+        int sprites = 0;
+        for (Placement& placement : placements) {
+            if (placement.page != static_cast<int>(i)) {
+                continue;
+            }
+            Entry& entry = *entries_.at(placement.sprite);
+            if (!texture) {
+                packed = uploadAlone(renderer, entry.sprite, placement.pixels) && packed;
+                continue;
+            }
+            const SDL_Rect& r = placement.rect;
+            entry.sprite = { texture, r, { r.x / width, r.y / height, r.w / width, r.h / height } };
+            entry.page = pageIndex;
+            SDL_FreeSurface(placement.pixels);
+            ++sprites;
+        }
+        if (texture) {
+            pages_.push_back({ texture, sprites });
+        }
+    }
+    return packed;
+}
+
+void SpriteBatch::draw(SDL_Renderer* renderer, const Sprite& sprite, const SDL_FRect& dest) {
+    if (!sprite.texture) { // not packed yet
+        return;
+    }
+    if (sprite.texture != texture_) {
+        flush(renderer);
+        texture_ = sprite.texture;
+    }
+
+    const SDL_Color white = { 255, 255, 255, 255 };
+    int first = static_cast<int>(vertices_.size());
+    const SDL_FRect& uv = sprite.uv;
+    vertices_.push_back({ { dest.x, dest.y }, white, { uv.x, uv.y } });
+    vertices_.push_back({ { dest.x + dest.w, dest.y }, white, { uv.x + uv.w, uv.y } });
+    vertices_.push_back({ { dest.x + dest.w, dest.y + dest.h }, white, { uv.x + uv.w, uv.y + uv.h } });
+    vertices_.push_back({ { dest.x, dest.y + dest.h }, white, { uv.x, uv.y + uv.h } });
+    for (int corner : { 0, 1, 2, 0, 2, 3 }) {
+        indices_.push_back(first + corner);
+    }
+}
+
+void SpriteBatch::flush(SDL_Renderer* renderer) {
+    if (indices_.empty()) {
+        return;
+    }
+    SDL_RenderGeometry(renderer, texture_, vertices_.data(), static_cast<int>(vertices_.size()), indices_.data(), static_cast<int>(indices_.size()));
+    renderStats.draw(texture_);
+    vertices_.clear();
+    indices_.clear();
+}
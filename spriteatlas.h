@@ -0,0 +1,72 @@
+#pragma once
+#include <SDL2/SDL.h>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+// Where a sprite's pixels are: a rect of an atlas page, or the whole of a texture of its own for
+// sprites too big for a page. GameObjects and the menus draw through these. texture stays
+// nullptr until the atlas is packed.
+struct Sprite {
+    SDL_Texture* texture = nullptr;
+    SDL_Rect rect{}; // in pixels of texture
+    SDL_FRect uv{}; // rect in 0..1 of texture
+};
+
+// Copies sprite to dest with SDL_RenderCopyF, for drawing outside a SpriteBatch
+void renderSprite(SDL_Renderer* renderer, const Sprite& sprite, const SDL_FRect& dest);
+
+// The sprite images packed into as few textures as the renderer allows. A sprite's pixels are
+// only kept until it is packed, after that its page is the one copy of them.
+class SpriteAtlas {
+public:
+    SpriteAtlas() = default;
+    ~SpriteAtlas();
+
+    SpriteAtlas(const SpriteAtlas&) = delete;
+    SpriteAtlas& operator=(const SpriteAtlas&) = delete;
+
+    // Takes ownership of pixels (see decodeImage) and keeps them for the next pack(). Pixels too
+    // big for a page are uploaded as the sprite's own texture right away. Returns nullptr, freeing
+    // them, on failure.
+    const Sprite* add(SDL_Renderer* renderer, SDL_Surface* pixels);
+    // Forgets a sprite add() returned. A page goes once none of its sprites are left.
+    void unload(const Sprite* sprite);
+    void destroy();
+
+    // Packs the sprites added since the last pack into new pages and frees their pixels. Call
+    // after loading and never between drawing and flushing a SpriteBatch. Sprites whose page
+    // could not be created get textures of their own instead.
+    bool pack(SDL_Renderer* renderer);
+
+    [[nodiscard]] size_t pageCount() const;
+
+private:
+    struct Page {
+        SDL_Texture* texture;
+        int sprites; // still loaded
+    };
+    struct Entry {
+        Sprite sprite;
+        SDL_Surface* pixels; // until packed
+        int page; // -1 while unpacked or when the sprite has a texture of its own
+    };
+
+    std::unordered_map<const Sprite*, std::unique_ptr<Entry>> entries_;
+    std::vector<Page> pages_; // never shrinks, so Entry::page stays valid
+};
+
+// Collects textured quads and sends runs that share a texture as one SDL_RenderGeometry call.
+// Sprites in the atlas all share their page, so a whole frame of them is usually a single call.
+class SpriteBatch {
+public:
+    // Queues sprite drawn to dest, flushing first when it needs a different texture than the queued quads
+    void draw(SDL_Renderer* renderer, const Sprite& sprite, const SDL_FRect& dest);
+    // Sends the queued quads, call before anything is drawn without the batch
+    void flush(SDL_Renderer* renderer);
+
+private:
+    SDL_Texture* texture_ = nullptr; // of the queued quads
+    std::vector<SDL_Vertex> vertices_; // kept between frames so batching allocates nothing
+    std::vector<int> indices_;
+};
@@ -0,0 +1,89 @@
+// ReSharper disable CppLocalVariableMayBeConst
+#include "staticlayer.h"
+#include <algorithm>
+#include "renderstats.h"
+#include "spriteatlas.h"
+
+using namespace std;
+
+namespace {
+
+// The part of the chunk inside the level, edge chunks of levels that aren't a whole number of chunks are smaller
+SDL_FRect chunkArea(const Level& level, const Chunk& chunk) {
+    SDL_FRect area = chunkRect(chunk);
+    area.w = min(area.w, static_cast<float>(level.header.cols * TILE_SIZE) - area.x);
+    area.h = min(area.h, static_cast<float>(level.header.rows * TILE_SIZE) - area.y);
+    return area;
+}
+
+} // namespace
+
+StaticLayerCache::~StaticLayerCache() {
+    clear();
+}
+
+void StaticLayerCache::clear() {
+    for (const Entry& entry : entries_) {
+        SDL_DestroyTexture(entry.texture);
+    }
+    entries_.clear();
+}
+
+SDL_Texture* StaticLayerCache::bake(SDL_Renderer* renderer, const Level& level, const Chunk& chunk, const SDL_FRect& area) const {
+    SDL_Texture* texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET, static_cast<int>(area.w), static_cast<int>(area.h));
+    if (!texture) {
+        return nullptr;
+    }
+    SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+
+    SDL_Texture* previousTarget = SDL_GetRenderTarget(renderer);
+    SDL_SetRenderTarget(renderer, texture);
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+    SDL_RenderClear(renderer);
+    for (const GameObject& obj : chunk.gameObjects) {
+        if (level.isStatic(obj)) {
+            SDL_FRect rect = { obj.rect.x - area.x, obj.rect.y - area.y, obj.rect.w, obj.rect.h };
+            SDL_RenderCopyF(renderer, obj.sprite->texture, &obj.sprite->rect, &rect);
+        }
+    }
+    SDL_SetRenderTarget(renderer, previousTarget);
+    return texture;
+}
+
+bool StaticLayerCache::render(SDL_Renderer* renderer, const Level& level, const SDL_FRect& camera) {
+    if (!SDL_RenderTargetSupported(renderer)) {
+        return false;
+    }
+    if (revision_ != level.staticRevision) {
+        clear();
+        revision_ = level.staticRevision;
+    }
+
+    // Forget the chunks streamChunks has evicted
+    erase_if(entries_, [&](const Entry& entry) {
+        if (level.chunkAt(entry.col, entry.row)) {
+            return false;
+        }
+        SDL_DestroyTexture(entry.texture);
+        return true;
+    });
+
+    for (const Chunk* chunk : level.residentChunks) {
+        SDL_FRect area = chunkArea(level, *chunk);
+        if (!hasIntersection(area, camera)) {
+            continue;
+        }
+        auto it = ranges::find_if(entries_, [&](const Entry& entry) { return entry.col == chunk->col && entry.row == chunk->row; });
+        if (it == entries_.end()) {
+            SDL_Texture* texture = bake(renderer, level, *chunk, area);
+            if (!texture) {
+                return false;
+            }
+            it = entries_.insert(entries_.end(), { chunk->col, chunk->row, texture });
+        }
+        SDL_FRect screenRect = { area.x - camera.x, area.y - camera.y, area.w, area.h };
+        SDL_RenderCopyF(renderer, it->texture, nullptr, &screenRect);
+        renderStats.draw(it->texture);
+    }
+    return true;
+}
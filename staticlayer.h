@@ -0,0 +1,37 @@
+#pragma once
+#include <vector>
+#include "level.h"
+
+// Bricks and vines never change once a level is loaded, so each resident chunk's are drawn once
+// into a transparent target texture and the whole chunk goes out as a single copy per frame.
+// Textures are dropped with their chunk when it is evicted, and all of them when
+// level.staticRevision changes.
+class StaticLayerCache {
+public:
+    StaticLayerCache() = default;
+    ~StaticLayerCache();
+
+    StaticLayerCache(const StaticLayerCache&) = delete;
+    StaticLayerCache& operator=(const StaticLayerCache&) = delete;
+
+    // Draws the bricks and vines of every resident chunk the camera sees. Returns false, drawing
+    // nothing, when the renderer has no target textures and the caller has to draw them itself.
+    bool render(SDL_Renderer* renderer, const Level& level, const SDL_FRect& camera);
+
+    // Drops every texture, needed after SDL_RENDER_TARGETS_RESET lost their contents
+    void clear();
+
+    [[nodiscard]] size_t textureCount() const { return entries_.size(); }
+
+private:
+    struct Entry {
+        int col;
+        int row;
+        SDL_Texture* texture;
+    };
+
+    SDL_Texture* bake(SDL_Renderer* renderer, const Level& level, const Chunk& chunk, const SDL_FRect& area) const;
+
+    std::vector<Entry> entries_;
+    uint32_t revision_ = 0;
+};
@@ -0,0 +1,43 @@
+#include "threadpool.h"
+#include <algorithm>
+#include "profiler.h"
+
+using namespace std;
+
+ThreadPool::ThreadPool(size_t threads) {
+    if (threads == 0) {
+        threads = max(thread::hardware_concurrency(), 1u);
+    }
+    workers_.reserve(threads);
+    for (size_t i = 0; i < threads; ++i) {
+        workers_.emplace_back([this] { work(); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        lock_guard lock(mutex_);
+        stopping_ = true;
+    }
+    ready_.notify_all();
+    for (thread& worker : workers_) {
+        worker.join();
+    }
+}
+
+void ThreadPool::work() {
+    profiler.nameThread("pool worker");
+    while (true) {
+        function<void()> task;
+        {
+            unique_lock lock(mutex_);
+            ready_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+            if (queue_.empty()) {
+                return;
+            }
+            task = std::move(queue_.front());
+            queue_.pop_front();
+        }
+        task();
+    }
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// A fixed set of worker threads running submitted tasks in order. Destroying the pool runs
+// what is still queued, then joins the workers.
+class ThreadPool {
+public:
+    // One worker per hardware thread when threads is 0
+    explicit ThreadPool(size_t threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    [[nodiscard]] size_t size() const { return workers_.size(); }
+
+    // Queues fn, its result or exception comes out of the returned future
+    template<typename Fn>
+    auto submit(Fn&& fn) -> std::future<std::invoke_result_t<Fn>> {
+        // std::function needs a copyable target, the packaged_task is shared instead
+        auto task = std::make_shared<std::packaged_task<std::invoke_result_t<Fn>()>>(std::forward<Fn>(fn));
+        auto result = task->get_future();
+        {
+            std::lock_guard lock(mutex_);
+            queue_.emplace_back([task] { (*task)(); });
+        }
+        ready_.notify_one();
+        return result;
+    }
+
+private:
+    void work();
+
+    std::vector<std::thread> workers_;
+    std::deque<std::function<void()>> queue_;
+    std::mutex mutex_;
+    std::condition_variable ready_;
+    bool stopping_ = false;
+};
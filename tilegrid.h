@@ -0,0 +1,22 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// Dense grid with one cell per tile. Every object loadLevel creates covers exactly one tile,
+// so a cell only has to hold the index of that object in its chunk's gameObjects, or -1
+// when the tile is empty. Physics queries visit the handful of cells a rect overlaps
+// instead of scanning every object.
+struct TileGrid {
+    int cols = 0;
+    int rows = 0;
+    std::vector<int32_t> cells;
+
+    void reset(int newCols, int newRows) {
+        cols = newCols;
+        rows = newRows;
+        cells.assign(static_cast<size_t>(cols) * rows, -1);
+    }
+
+    int32_t at(int col, int row) const { return cells[static_cast<size_t>(row) * cols + col]; }
+    int32_t& at(int col, int row) { return cells[static_cast<size_t>(row) * cols + col]; }
+};
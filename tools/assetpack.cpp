@@ -0,0 +1,174 @@
+// Build-time asset packer: decodes everything under resources/ and compiles levels/ into the single
+// file the game memory-maps (see assetpack.h), so that startup decodes nothing.
+// Usage: assetpack <source dir> <output.pak>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#include <SDL2/SDL_mixer.h>
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "../assetcache.h"
+#include "../assetpack.h"
+#include "../levelformat.h"
+
+using namespace std;
+
+namespace {
+
+struct PackedAsset {
+    string name;
+    AssetKind kind;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    string bytes;
+};
+
+string readFile(const string& path) {
+    ifstream in(path, ios::binary);
+    if (!in) {
+        throw runtime_error("Error: Cannot open " + path);
+    }
+    return { istreambuf_iterator<char>(in), istreambuf_iterator<char>() };
+}
+
+PackedAsset packImage(const string& name, const string& path) {
+    DecodedImage decoded = decodeImage(path);
+    if (!decoded.pixels) {
+        throw runtime_error("Error: Cannot decode " + path + ": " + decoded.error);
+    }
+    SDL_Surface* surface = decoded.pixels;
+    PackedAsset asset = { name, ASSET_IMAGE, static_cast<uint32_t>(surface->w), static_cast<uint32_t>(surface->h), {} };
+    // Rows are stored without the surface's padding
+    size_t rowBytes = static_cast<size_t>(surface->w) * 4;
+    asset.bytes.resize(rowBytes * surface->h);
+    for (int y = 0; y < surface->h; ++y) {
+        memcpy(asset.bytes.data() + y * rowBytes, static_cast<const uint8_t*>(surface->pixels) + static_cast<size_t>(y) * surface->pitch, rowBytes);
+    }
+    SDL_FreeSurface(surface);
+    return asset;
+}
+
+PackedAsset packSound(const string& name, const string& path) {
+    Mix_Chunk* chunk = Mix_LoadWAV(path.c_str());
+    if (!chunk) {
+        throw runtime_error("Error: Cannot decode " + path + ": " + SDL_GetError());
+    }
+    PackedAsset asset = { name, ASSET_SOUND, 0, 0, string(reinterpret_cast<const char*>(chunk->abuf), chunk->alen) };
+    Mix_FreeChunk(chunk);
+    return asset;
+}
+
+PackedAsset packLevel(const string& name, const string& path) {
+    ifstream in(path);
+    if (!in) {
+        throw runtime_error("Error: Cannot open " + path);
+    }
+    return { name, ASSET_LEVEL, 0, 0, compiledLevelBytes(parseLevelText(in)) };
+}
+
+// Everything under source/folder the game loads, named by its path relative to source
+void collect(const filesystem::path& source, const string& folder, vector<PackedAsset>& assets) {
+    for (const auto& entry : filesystem::recursive_directory_iterator(source / folder)) {
+        if (!entry.is_regular_file()) {
+            continue;
+        }
+        string path = entry.path().string();
+        string name = filesystem::relative(entry.path(), source).generic_string();
+        string extension = entry.path().extension().string();
+        if (extension == ".png") {
+            assets.push_back(packImage(name, path));
+        } else if (extension == ".wav" || extension == ".mp3" || extension == ".ogg") {
+            assets.push_back(packSound(name, path));
+        } else if (extension == ".ttf") {
+            assets.push_back({ name, ASSET_FILE, 0, 0, readFile(path) });
+        } else if (extension == ".lvl") {
+            assets.push_back(packLevel(name, path));
+        }
+    }
+}
+
+size_t aligned(size_t offset) {
+    return (offset + assetPackAlignment - 1) & ~(assetPackAlignment - 1);
+}
+
+void writePack(vector<PackedAsset>& assets, const string& outPath) {
+    ranges::sort(assets, {}, &PackedAsset::name);
+
+    AssetPackHeader header{};
+    memcpy(header.magic, assetPackMagic, sizeof(header.magic));
+    header.version = assetPackVersion;
+    header.entryCount = static_cast<uint32_t>(assets.size());
+    int channels = 0;
+    Mix_QuerySpec(&header.audioFrequency, &header.audioFormat, &channels);
+    header.audioChannels = static_cast<uint16_t>(channels);
+
+    string names;
+    vector<AssetPackEntry> entries;
+    for (const PackedAsset& asset : assets) {
+        entries.push_back({ asset.kind, static_cast<uint32_t>(names.size()), static_cast<uint32_t>(asset.name.size()), asset.width, asset.height, 0, 0, asset.bytes.size() });
+        names += asset.name;
+    }
+    size_t offset = aligned(sizeof(header) + entries.size() * sizeof(AssetPackEntry) + names.size());
+    for (AssetPackEntry& entry : entries) {
+        entry.offset = offset;
+        offset = aligned(offset + entry.size);
+    }
+
+    ofstream out(outPath, ios::binary | ios::trunc);
+    if (!out) {
+        throw runtime_error("Error: Cannot write " + outPath);
+    }
+    string contents(reinterpret_cast<const char*>(&header), sizeof(header));
+    contents.append(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(AssetPackEntry));
+    contents += names;
+    for (size_t i = 0; i < assets.size(); ++i) {
+        contents.resize(entries[i].offset, '\0');
+        contents += assets[i].bytes;
+    }
+    out.write(contents.data(), static_cast<streamsize>(contents.size()));
+    if (!out) {
+        throw runtime_error("Error: Failed writing " + outPath);
+    }
+    cout << outPath << ": " << assets.size() << " assets, " << contents.size() / 1024 << " KiB" << endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc != 3) {
+        cerr << "Usage: " << argv[0] << " <source dir> <output.pak>" << endl;
+        return 2;
+    }
+
+    // Sounds are converted to whatever the mixer opens with, the same parameters the game uses
+    SDL_SetHint(SDL_HINT_AUDIODRIVER, "dummy");
+    if (SDL_Init(SDL_INIT_AUDIO) != 0 || Mix_OpenAudio(mixerFrequency, mixerFormat, mixerChannels, 2048) != 0) {
+        cerr << "Error: Cannot open the mixer: " << SDL_GetError() << endl;
+        return 1;
+    }
+    IMG_Init(IMG_INIT_PNG);
+
+    int result = 0;
+    try {
+        filesystem::path source = argv[1];
+        vector<PackedAsset> assets;
+        collect(source, "resources", assets);
+        collect(source, "levels", assets);
+        writePack(assets, argv[2]);
+    } catch (const exception& e) {
+        cerr << e.what() << endl;
+        result = 1;
+    }
+
+    IMG_Quit();
+    Mix_CloseAudio();
+    Mix_Quit();
+    SDL_Quit();
+    return result;
+}
@@ -0,0 +1,48 @@
+#!/usr/bin/env python3
+# Compares two marioSDL_bench --json result files and fails when a benchmark got slower.
+# Usage: bench_compare.py <baseline.json> <current.json> [--threshold PERCENT]
+import argparse
+import json
+import sys
+
+
+def load(path):
+    with open(path) as f:
+        return {(r["suite"], r["name"]): r["ns_per_op"] for r in json.load(f)["results"]}
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compare two marioSDL_bench --json files")
+    parser.add_argument("baseline")
+    parser.add_argument("current")
+    parser.add_argument("--threshold", type=float, default=10.0,
+                        help="percent slower than the baseline that counts as a regression (default 10)")
+    args = parser.parse_args()
+
+    baseline = load(args.baseline)
+    current = load(args.current)
+
+    regressions = 0
+    print(f"{'benchmark':<60} {'baseline':>14} {'current':>14} {'change':>9}")
+    for key, ns in current.items():
+        name = f"{key[0]}: {key[1]}"
+        if key not in baseline:
+            print(f"{name:<60} {'-':>14} {ns:>14.1f} {'new':>9}")
+            continue
+        before = baseline[key]
+        change = (ns - before) / before * 100 if before > 0 else 0.0
+        regressed = change > args.threshold
+        regressions += regressed
+        print(f"{name:<60} {before:>14.1f} {ns:>14.1f} {change:>+8.1f}%{'  REGRESSION' if regressed else ''}")
+    for key in sorted(baseline.keys() - current.keys()):
+        name = f"{key[0]}: {key[1]}"
+        print(f"{name:<60} {baseline[key]:>14.1f} {'-':>14} {'gone':>9}")
+
+    if regressions:
+        print(f"{regressions} benchmark(s) more than {args.threshold:g}% slower than the baseline")
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,31 @@
+// Offline level compiler: turns a text .lvl into the binary format loadLevel memory-maps.
+// Usage: levelc <input.lvl> <output.lvlb>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include "../levelformat.h"
+
+using namespace std;
+
+int main(int argc, char* argv[]) {
+    if (argc != 3) {
+        cerr << "Usage: " << argv[0] << " <input.lvl> <output.lvlb>" << endl;
+        return 2;
+    }
+
+    try {
+        ifstream in(argv[1]);
+        if (!in) {
+            throw runtime_error("Error: Cannot open " + string(argv[1]));
+        }
+        LevelData data = parseLevelText(in);
+        data.header.sourceHash = levelSourceHash(argv[1]);
+        writeCompiledLevel(data, argv[2]);
+        cout << argv[1] << " -> " << argv[2] << " (" << data.header.cols << "x" << data.header.rows << ", "
+             << data.header.objectCount << " objects, " << data.header.enemyCount << " enemies)" << endl;
+    } catch (const exception& e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}
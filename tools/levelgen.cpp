@@ -0,0 +1,222 @@
+// Procedural level generator for scaling tests: writes text .lvl files of any size and density,
+// the same seed always giving the same level.
+// Usage: levelgen [options] <output.lvl>
+//        levelgen --corpus <dir> [--seed N]
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "../levelformat.h"
+
+using namespace std;
+
+namespace {
+
+struct GenParams {
+    int cols = 200;
+    int rows = 15;
+    double bricks = 0.2; // fractions of the cells above the floor
+    double vines = 0.05;
+    double coins = 0.03;
+    double lives = 0.002;
+    int enemies = 10; // '$' pairs
+    uint32_t seed = 1;
+};
+
+// The stress corpus: long and tall levels, one big enough to need many chunks resident at once,
+// a crowd of enemies and an empty level as the baseline
+struct CorpusLevel {
+    const char* name;
+    GenParams params;
+};
+
+const CorpusLevel corpus[] = {
+    { "stress-empty", { 10000, 15, 0, 0, 0, 0, 0 } },
+    { "stress-wide", { 10000, 15, 0.2, 0.05, 0.03, 0.002, 500 } },
+    { "stress-tall", { 200, 2000, 0.2, 0.05, 0.03, 0.002, 2000 } },
+    { "stress-huge", { 1000, 1000, 0.25, 0.08, 0.05, 0.005, 5000 } },
+    { "stress-enemies", { 2000, 15, 0.05, 0.02, 0.02, 0, 1500 } },
+    { "stress-coins", { 2000, 15, 0.05, 0.02, 0.5, 0.05, 20 } },
+};
+
+// Every level has a floor of bricks, the player at its left end and the door at its right. Each
+// enemy gets a patrol of 2 to 8 tiles on an empty row with bricks under it, and never shares a
+// tile of it, or of the row below, with another enemy, the player or the door, so the '$'
+// markers always pair up as generated.
+string generateLevel(const GenParams& params, int& enemiesPlaced) {
+    if (params.cols < 4 || params.rows < 3) {
+        throw runtime_error("Error: A level needs at least 4 columns and 3 rows");
+    }
+    if (params.bricks < 0 || params.vines < 0 || params.coins < 0 || params.lives < 0 ||
+        params.bricks + params.vines + params.coins + params.lives > 1) {
+        throw runtime_error("Error: Tile ratios must be positive and add up to at most 1");
+    }
+
+    int cols = params.cols;
+    int rows = params.rows;
+    int floorRow = rows - 1;
+    mt19937 rng(params.seed);
+    vector<string> grid(rows, string(cols, '.'));
+    grid[floorRow].assign(cols, '1');
+
+    uniform_real_distribution<double> roll(0, 1);
+    for (int row = 0; row < floorRow; ++row) {
+        for (int col = 0; col < cols; ++col) {
+            double r = roll(rng);
+            double edge = params.bricks;
+            if (r < edge) {
+                grid[row][col] = '1';
+            } else if (r < (edge += params.vines)) {
+                grid[row][col] = '/';
+            } else if (r < (edge += params.coins)) {
+                grid[row][col] = '+';
+            } else if (r < edge + params.lives) {
+                grid[row][col] = '^';
+            }
+        }
+    }
+
+    // The floor is never claimed, it is bricks everywhere anyway
+    vector<bool> claimed(static_cast<size_t>(cols) * rows, false);
+    auto isClaimed = [&](int col, int row) { return row < floorRow && claimed[static_cast<size_t>(row) * cols + col]; };
+    auto claim = [&](int col, int row) {
+        if (row < floorRow) {
+            claimed[static_cast<size_t>(row) * cols + col] = true;
+        }
+    };
+
+    // The player and the door stand on the floor with an empty tile above them
+    struct Spot { int col; char tile; };
+    for (Spot spot : { Spot{ 1, '@' }, Spot{ cols - 2, 'D' } }) {
+        for (int row = max(floorRow - 2, 0); row < floorRow; ++row) {
+            grid[row][spot.col] = '.';
+            claim(spot.col, row);
+        }
+        grid[floorRow - 1][spot.col] = spot.tile;
+    }
+
+    enemiesPlaced = 0;
+    uniform_int_distribution<int> pickRow(0, floorRow - 1);
+    uniform_int_distribution<int> pickLength(2, min(8, cols - 1));
+    for (int attempts = params.enemies * 20; enemiesPlaced < params.enemies && attempts > 0; --attempts) {
+        int row = pickRow(rng);
+        int length = pickLength(rng);
+        int start = uniform_int_distribution<int>(0, cols - 1 - length)(rng);
+        bool free = true;
+        for (int col = start; col <= start + length && free; ++col) {
+            free = !isClaimed(col, row) && !isClaimed(col, row + 1);
+        }
+        if (!free) {
+            continue;
+        }
+        for (int col = start; col <= start + length; ++col) {
+            grid[row][col] = '.';
+            grid[row + 1][col] = '1';
+            claim(col, row);
+            claim(col, row + 1);
+        }
+        grid[row][start] = '$';
+        grid[row][start + length] = '$';
+        ++enemiesPlaced;
+    }
+
+    string text;
+    text.reserve(static_cast<size_t>(cols + 1) * rows);
+    for (const string& line : grid) {
+        text += line;
+        text += '\n';
+    }
+    return text;
+}
+
+// Generates the level, checks the game parses it back as generated and writes it
+void writeLevel(const GenParams& params, const string& path) {
+    int enemiesPlaced;
+    string text = generateLevel(params, enemiesPlaced);
+    istringstream in(text);
+    LevelData data = parseLevelText(in);
+    if (data.header.playerCol < 0 || data.header.doorCol < 0 || data.header.enemyCount != static_cast<uint32_t>(enemiesPlaced)) {
+        throw runtime_error("Error: Generated an invalid level for " + path);
+    }
+
+    ofstream out(path, ios::binary);
+    if (!out || !out.write(text.data(), static_cast<streamsize>(text.size()))) {
+        throw runtime_error("Error: Cannot write " + path);
+    }
+    cout << path << " (" << params.cols << "x" << params.rows << ", seed " << params.seed << ", " << data.header.objectCount << " objects, "
+         << enemiesPlaced << " enemies)" << endl;
+    if (enemiesPlaced < params.enemies) {
+        cerr << "Warning: Only room for " << enemiesPlaced << " of " << params.enemies << " enemies in " << path << endl;
+    }
+}
+
+int usage(const char* program) {
+    cerr << "Usage: " << program << " [--cols N] [--rows N] [--bricks R] [--vines R] [--coins R] [--lives R]\n"
+         << "           [--enemies N] [--seed N] <output.lvl>\n"
+         << "       " << program << " --corpus <dir> [--seed N]\n"
+         << "Ratios are fractions of the tiles above the floor, enemies are '$' pairs." << endl;
+    return 2;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    GenParams params;
+    string outputPath;
+    string corpusDir;
+    try {
+        for (int i = 1; i < argc; ++i) {
+            string arg = argv[i];
+            bool hasValue = i + 1 < argc;
+            if (arg == "--cols" && hasValue) {
+                params.cols = stoi(argv[++i]);
+            } else if (arg == "--rows" && hasValue) {
+                params.rows = stoi(argv[++i]);
+            } else if (arg == "--bricks" && hasValue) {
+                params.bricks = stod(argv[++i]);
+            } else if (arg == "--vines" && hasValue) {
+                params.vines = stod(argv[++i]);
+            } else if (arg == "--coins" && hasValue) {
+                params.coins = stod(argv[++i]);
+            } else if (arg == "--lives" && hasValue) {
+                params.lives = stod(argv[++i]);
+            } else if (arg == "--enemies" && hasValue) {
+                params.enemies = stoi(argv[++i]);
+            } else if (arg == "--seed" && hasValue) {
+                params.seed = static_cast<uint32_t>(stoul(argv[++i]));
+            } else if (arg == "--corpus" && hasValue) {
+                corpusDir = argv[++i];
+            } else if (arg[0] != '-' && outputPath.empty()) {
+                outputPath = arg;
+            } else {
+                return usage(argv[0]);
+            }
+        }
+    } catch (const exception&) {
+        return usage(argv[0]);
+    }
+    if (corpusDir.empty() == outputPath.empty()) {
+        return usage(argv[0]);
+    }
+
+    try {
+        if (!corpusDir.empty()) {
+            filesystem::create_directories(corpusDir);
+            for (const CorpusLevel& level : corpus) {
+                GenParams corpusParams = level.params;
+                corpusParams.seed = params.seed;
+                writeLevel(corpusParams, (filesystem::path(corpusDir) / (string(level.name) + ".lvl")).string());
+            }
+        } else {
+            writeLevel(params, outputPath);
+        }
+    } catch (const exception& e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
+    return 0;
+}